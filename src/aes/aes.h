@@ -8,6 +8,9 @@
 // for a fixed block length of 128 bits (Nb = 4) and can run with either 
 // big or little endian internal byte order.
 
+#if !defined(aes_h)
+#define aes_h
+
 #define AES_BIG_ENDIAN		1	// do not change
 #define	AES_LITTLE_ENDIAN	2	// do not change
 
@@ -31,7 +34,7 @@
 #endif
 
 typedef unsigned char   byte;	// must be an 8-bit storage unit
-typedef unsigned long   word;	// must be a 32-bit storage unit
+typedef unsigned int    word;	// must be a 32-bit storage unit, even on LP64
 
 #if(INTERNAL_BYTE_ORDER == AES_LITTLE_ENDIAN)
 
@@ -126,3 +129,5 @@ private:
     word    d_key[64];	// the decryption key schedule (128 bit block only)
     aes_key	mode;		// encrypt, decrypt or both
 };
+
+#endif
@@ -10,34 +10,161 @@
 |  distributed. The author assumes no responsibility     |
 |  for damaged caused due to the use of this program.    |
 |--------------------------------------------------------|
-| rawaes.cpp                               (file 1 of 2) |
+| rawaes.cpp                                    (file 1) |
 |********************************************************/
 
 #include "rawaes.h"
 
-int main(int argc, char** argv) try {
-	// Arguments
-	char*	flag;
-	char*	keyt;
-	char*	path1;  // input file
-	char*	path2;  // output file
+rawaes_opts::rawaes_opts(void)
+	: argn(0), path1(NULL), path2(NULL), dir_enc(true), key_size(128),
+	manifest(NULL), archive(NULL), store(NULL), recurse(false), container(false),
+	cmode(rawcont::ctr), chunk(rawcont::chunk_size), partial(false), update(false),
+	incremental(false), compress(false), sum_kind(checksum::none), sum_plain(true),
+	sum_cipher(false), sum_file(NULL), expect(NULL), verify(false), newkey(NULL),
+	shard_size(0), ranged(false), range_from(0), range_to(0), job(NULL), merge(false),
+	checkpoint(0), resume(false), offset(0), length(~static_cast<uint64>(0)),
+	threads(rawpool::cpus())
+{
+	io.sync_batch = &syncs;
+}
+
+// The key is taken from the characters typed, zero padded to the size of
+// the key, so a short key never reads past the end of the text given.  Both
+// schedules are expanded: containers decrypt with the encryption schedule
+// in counter mode, and check the key with it in every mode.
+
+static void rawaes_key(aes& crypto, const char* keyt, const int key_size)
+{
+	byte	keydt[32];
+	int		keyln = strlen(keyt);
 	
-	// Check Arguments For "--help" or "--version"
-	if (argc > 1) {
-		flag = *(argv + 1);
+	if (keyln > key_size / 8) keyln = key_size / 8;
+	
+	memset(keydt, 0, sizeof(keydt));
+	for (int i = 0; i < keyln; ++i) *(keydt + i) = static_cast<byte>(*(keyt + i));
+	
+	crypto.key(keydt, key_size, aes::both);
+	
+	memset(keydt, 0, sizeof(keydt));
+}
+
+// Separates the options from the arguments, checks they go together, and
+// sets up the key.
+
+static void rawaes_parse(int argc, char** argv, rawaes_opts& o)
+{
+	for (int i = 1; i < argc; ++i) {
+		char* arg = *(argv + i);
 		
-		if (strcmp("--help", flag) == 0) { cout << rawaes_menu; exit(0); }
-		if (strcmp("--version", flag) == 0) { cout << rawaes_version; exit(0); }
+		if (strcmp("--direct", arg) == 0) o.io.direct = true;
+		else if (strcmp("--cache=keep", arg) == 0) o.io.cache = rawfile::keep;
+		else if (strcmp("--cache=sequential", arg) == 0) o.io.cache = rawfile::sequential;
+		else if (strcmp("--cache=drop", arg) == 0) o.io.cache = rawfile::drop;
+		else if (strcmp("--sync=none", arg) == 0) o.io.durability = rawfile::none;
+		else if (strcmp("--sync=file", arg) == 0) o.io.durability = rawfile::file;
+		else if (strcmp("--sync=batch", arg) == 0) o.io.durability = rawfile::batch;
+		else if (strcmp("--sync=periodic", arg) == 0) o.io.durability = rawfile::periodic;
+		else if (strncmp("--sync=periodic:", arg, 16) == 0) {
+			// strtoull takes signs and spaces, so the digits are checked first
+			char* end = NULL;
+			unsigned long long mb = strtoull(arg + 16, &end, 10);
+			
+			if (!isdigit(static_cast<unsigned char>(arg[16])) || *end != 0 || mb == 0
+				|| mb > static_cast<unsigned long long>(std::numeric_limits<off_t>::max() >> 20))
+				throw "Periodic Sync Needs a Size in MB!";
+			
+			o.io.durability = rawfile::periodic;
+			o.io.sync_every = static_cast<off_t>(mb) << 20;
+		}
+		else if (strncmp("--batch=", arg, 8) == 0) o.manifest = arg + 8;
+		else if (strncmp("--archive=", arg, 10) == 0) o.archive = arg + 10;
+		else if (strncmp("--store=", arg, 8) == 0) o.store = arg + 8;
+		else if (strcmp("-r", arg) == 0) o.recurse = true;
+		else if (strcmp("--container", arg) == 0) o.container = true;
+		else if (strcmp("--mode=ecb", arg) == 0) o.cmode = rawcont::ecb;
+		else if (strcmp("--mode=ctr", arg) == 0) o.cmode = rawcont::ctr;
+		else if (strncmp("--chunk=", arg, 8) == 0) {
+			long kb = atol(arg + 8);
+			if (kb < 4 || kb > rawcont::chunk_size >> 10 || kb % 4 != 0)
+				throw "Chunk Size Must Be 4 to 1024 KB, a Multiple of 4!";
+			o.chunk = static_cast<uint32>(kb) << 10;
+		}
+		else if (strcmp("--update", arg) == 0) o.update = true;
+		else if (strcmp("--incremental", arg) == 0) o.incremental = o.container = true;
+		else if (strcmp("--compress", arg) == 0) o.compress = o.container = true;
+		else if (strncmp("--sum=", arg, 6) == 0) {
+			o.sum_kind = checksum::parse(arg + 6);
+			if (o.sum_kind == checksum::none) throw "Checksum Must Be xxh64, crc32c or sha256!";
+		}
+		else if (strcmp("--sum-of=plain", arg) == 0) { o.sum_plain = true; o.sum_cipher = false; }
+		else if (strcmp("--sum-of=cipher", arg) == 0) { o.sum_plain = false; o.sum_cipher = true; }
+		else if (strcmp("--sum-of=both", arg) == 0) o.sum_plain = o.sum_cipher = true;
+		else if (strncmp("--sum-file=", arg, 11) == 0) o.sum_file = arg + 11;
+		else if (strncmp("--expect=", arg, 9) == 0) o.expect = arg + 9;
+		else if (strcmp("--verify", arg) == 0) o.verify = true;
+		else if (strncmp("--rekey=", arg, 8) == 0) o.newkey = arg + 8;
+		else if (strncmp("--range=", arg, 8) == 0) {
+			char* colon = NULL;
+			o.range_from = strtoull(arg + 8, &colon, 10);
+			if (*colon != ':') throw "--range Needs first:end Chunk Numbers!";
+			o.range_to = strtoull(colon + 1, NULL, 10);
+			if (o.range_to <= o.range_from) throw "--range Needs first:end Chunk Numbers!";
+			o.ranged = o.container = true;
+		}
+		else if (strncmp("--job=", arg, 6) == 0) o.job = arg + 6;
+		else if (strcmp("--merge", arg) == 0) o.merge = true;
+		else if (strcmp("--checkpoint", arg) == 0) o.checkpoint = 30;
+		else if (strncmp("--checkpoint=", arg, 13) == 0) {
+			o.checkpoint = atoi(arg + 13);
+			if (o.checkpoint < 1) throw "--checkpoint Needs a Number of Seconds!";
+		}
+		else if (strcmp("--resume", arg) == 0) o.resume = true;
+		else if (strncmp("--shard-size=", arg, 13) == 0) {
+			o.shard_size = static_cast<uint64>(strtoull(arg + 13, NULL, 10)) << 20;
+			if (o.shard_size == 0) throw "--shard-size Needs a Size in MB!";
+		}
+		else if (strncmp("--also=", arg, 7) == 0) {
+			if (strchr(arg + 7, ':') == NULL) throw "--also Needs key:output_file!";
+			o.also.push_back(arg + 7);
+		}
+		else if (strncmp("--offset=", arg, 9) == 0) {
+			o.offset = strtoull(arg + 9, NULL, 10);
+			o.partial = true;
+		}
+		else if (strncmp("--length=", arg, 9) == 0) {
+			o.length = strtoull(arg + 9, NULL, 10);
+			o.partial = true;
+		}
+		else if (strncmp("--threads=", arg, 10) == 0) {
+			o.threads = atol(arg + 10);
+			if (o.threads < 1) throw "Must Have at Least 1 Thread!";
+		}
+		else if (o.argn < 4) o.args[o.argn++] = arg;
+		else throw "Must have 4 arguments!";
 	}
-	else { cout << rawaes_menu; exit(0); }
 	
 	// Check Argument Count
-	if (argc != 5) throw "Must have 4 arguments!";
+	if ((o.partial || o.update || o.verify || o.newkey != NULL || !o.also.empty() || o.shard_size != 0
+		|| o.ranged || o.merge || o.checkpoint != 0 || o.resume || o.sum_kind != checksum::none)
+		&& (o.manifest != NULL || o.archive != NULL || o.store != NULL || o.recurse))
+		throw "--offset, --length, --update, --verify, --rekey, --also, --shard-size, --range, --merge, --checkpoint, --resume and --sum Need a Single Input File!";
+	if (o.manifest != NULL && o.argn != 2) throw "Must have 2 arguments with --batch!";
+	if (o.verify && o.argn != 3 && o.argn != 4) throw "Must have 3 or 4 arguments with --verify!";
+	if (o.manifest == NULL && !o.verify && o.argn != 4) throw "Must have 4 arguments!";
+	if (o.expect != NULL && (!o.verify || o.sum_kind == checksum::none))
+		throw "--expect Needs --verify and a --sum!";
+	if (o.compress && o.incremental) throw "--compress and --incremental Cannot Be Combined!";
+	if (o.ranged && (o.incremental || o.merge)) throw "--range Cannot Be Combined With --incremental or --merge!";
+	if (o.job != NULL && !o.ranged) throw "--job Only Applies With --range!";
+	if (o.resume && o.checkpoint == 0) o.checkpoint = 30;
+	if (o.checkpoint != 0 && (!o.container || o.incremental || o.merge))
+		throw "--checkpoint and --resume Need --container, --compress or --range, Without --incremental!";
+	
+	// containers, archives, recipes and the like are moved a header at a
+	// time, which direct I/O cannot do, so they go through the page cache
+	o.cio = o.io.buffered();
 	
-	// AES Class Variable
-	bool	dir_enc = true;
-	int		key_size = 128;
-	aes		crypto;
+	char* flag = o.args[0];
 	
 	// Check Direction and Key Size
 	if (
@@ -45,23 +172,23 @@ int main(int argc, char** argv) try {
 		strcmp("--decrypt", flag) == 0 ||
 		strcmp("-d16", flag) == 0 ||
 		strcmp("-d128", flag) == 0
-	) {	dir_enc = false; }
+	) {	o.dir_enc = false; }
 	else if (
 		strcmp("-d24", flag) == 0 ||
 		strcmp("-d192", flag) == 0
-	) { dir_enc = false; key_size = 192; }
+	) { o.dir_enc = false; o.key_size = 192; }
 	else if (
 		strcmp("-d32", flag) == 0 ||
 		strcmp("-d256", flag) == 0
-	) { dir_enc = false; key_size = 256; }
+	) { o.dir_enc = false; o.key_size = 256; }
 	else if (
 		strcmp("-e32", flag) == 0 ||
 		strcmp("-e256", flag) == 0
-	) { key_size = 256; }
+	) { o.key_size = 256; }
 	else if (
 		strcmp("-e24", flag) == 0 ||
 		strcmp("-e192", flag) == 0
-	) { key_size = 192; }
+	) { o.key_size = 192; }
 	else if (
 		strcmp("-e", flag) != 0 &&
 		strcmp("--encrypt", flag) != 0 &&
@@ -70,90 +197,568 @@ int main(int argc, char** argv) try {
 	) { throw "Must Specify Direction: --encrypt --decrypt"; }
 	
 	// Initalize Key Set-up
-	keyt = *(argv + 2);
-	int		keyln = strlen(keyt);
-	byte*	keydt = new byte[keyln];
-	for (int i = 0; i < keyln; ++i) *(keydt + i) = static_cast<byte>(*(keyt + i)); 
-		
-	if (dir_enc) crypto.key(keydt, key_size, aes::enc);
-	else crypto.key(keydt, key_size, aes::dec);
+	rawaes_key(o.crypto, o.args[1], o.key_size);
+	
+	o.path1 = (o.argn > 2) ? o.args[2] : NULL;
+	o.path2 = (o.argn > 3) ? o.args[3] : NULL;
+}
+
+// Pack Files Into an Archive
+
+static void rawaes_pack(rawaes_opts& o)
+{
+	if (o.manifest == NULL) throw "Archives Are Made From a --batch Manifest!";
 	
-	delete keydt;
+	rawbatch	files(o.io, o.dir_enc);
+	files.read(o.manifest, false);
 	
+	// members sit at offsets that are not page aligned
+	rawfile		afile;
+	if (afile.open(o.archive, rawfile::out, o.cio) != B_OK) throw "Cannot Initialize Output File!";
+	
+	cout << "Archiving " << files.size() << " files...";
+	
+	rawpool		workers(o.crypto, o.threads);
+	rawarch		arch(o.crypto, o.key_size);
+	
+	arch.create(afile, files.files(), o.io, workers);
+	afile.sync();
+	o.syncs.flush();
+	
+	if (workers.failures() != 0) throw "Some Files Could Not Be Processed!";
+}
+
+// Extract Files From an Archive
 
-	// Open Input and Output Files
-	path1 = *(argv + 3);
-	path2 = *(argv + 4);
+static void rawaes_unpack(rawaes_opts& o)
+{
+	rawfile		afile;
+	if (afile.open(o.archive, rawfile::in, o.cio) != B_OK) throw "Cannot Initialize Input File!";
 	
-	BFile*	fin;
-	BFile*	fout;
+	rawarch		arch(o.crypto, o.key_size);
+	arch.open(afile);
 	
-	fin = new BFile(path1, B_READ_ONLY);
-	if (fin->InitCheck() != B_OK) {
-		delete fin;
+	rawbatch	files(o.io, o.dir_enc);
+	if (o.manifest != NULL) files.read(o.manifest, false);
+	else files.add(o.args[2], o.args[3]);
+	
+	cout << "Extracting " << files.size() << " files...";
+	
+	rawpool		workers(o.crypto, o.threads);
+	arch.extract(afile, files.files(), o.io, workers);
+	o.syncs.flush();
+	
+	if (workers.failures() != 0) throw "Some Files Could Not Be Processed!";
+}
+
+// Encrypt or Decrypt Every File in a Batch
+
+static void rawaes_batch(rawaes_opts& o)
+{
+	rawbatch	files(o.io, o.dir_enc);
+	files.read(o.manifest);
+	
+	if (o.dir_enc) cout << "Encrypting " << files.size() << " files...";
+	else cout << "Decrypting " << files.size() << " files...";
+	
+	if (o.threads > 1) {
+		rawpool	workers(o.crypto, o.threads);
+		files.run(workers);
+	}
+	else files.run(o.crypto, o.pool);
+	
+	o.syncs.flush();
+	
+	if (files.failures() != 0) throw "Some Files Could Not Be Processed!";
+}
+
+// Move a File to a New Key in One Pass
+
+static void rawaes_rekey(rawaes_opts& o)
+{
+	if (o.dir_enc) throw "--rekey Needs -d and the Old Key!";
+	
+	rawfile		fin;
+	rawfile		fout;
+	struct stat	sin;
+	struct stat	sout;
+	
+	if (fin.open(o.path1, rawfile::in, o.cio) != B_OK || stat(o.path1, &sin) != 0)
 		throw "Cannot Initialize Input File!";
+	
+	// the output may be the input itself; rewritten in place, a run cut
+	// short would leave it under neither key, so a new copy is made
+	// and renamed over it once it is whole on disk
+	bool	same = stat(o.path2, &sout) == 0 && sin.st_dev == sout.st_dev && sin.st_ino == sout.st_ino;
+	string	temp = same ? string(o.path2) + ".rekey" : string(o.path2);
+	
+	if (same) unlink(temp.c_str());
+	if (fout.open(temp.c_str(), rawfile::out, o.cio) != B_OK) throw "Cannot Initialize Output File!";
+	
+	aes		fresh;
+	rawaes_key(fresh, o.newkey, o.key_size);
+	
+	cout << "Rekeying...";
+	
+	rawpool	workers(o.crypto, o.threads);
+	
+	try {
+		if (rawcont::detect(fin)) {
+			rawcont	cont(o.crypto, o.key_size);
+			
+			cont.open(fin);
+			cont.rekey(fin, fout, fresh, workers);
+		}
+		else {
+			rawrekey	rekey(workers, fresh);
+			rekey.run(fin, fout);
+		}
+	} catch (...) {
+		if (same) unlink(temp.c_str());
+		throw;
 	}
 	
-	fout = new BFile(path2, B_WRITE_ONLY|B_CREATE_FILE);
-	if (fout->InitCheck() != B_OK) {
-		fin->Unset();
-		delete fin;
-		delete fout;
-		throw "Cannot Initialize Output File!";
+	if (same) {
+		fout.datasync();
+		chmod(temp.c_str(), sin.st_mode & 07777);
+		fout.unset();
+		
+		if (rename(temp.c_str(), o.path2) != 0) throw "Cannot Replace Input File!";
+		rawfile::sync_dir(o.path2);
 	}
+	else fout.sync();
 	
-	// Get Input File Dimensions
-	off_t* fin_size_temp = new off_t;
-	fin->GetSize(fin_size_temp);
+	o.syncs.flush();
+}
+
+// Encrypt One Input Under Several Keys, Reading It Once
+
+static void rawaes_fanout(rawaes_opts& o)
+{
+	if (!o.dir_enc || o.container || o.shard_size != 0 || o.sum_kind != checksum::none)
+		throw "--also Needs -e and Makes Plain rawaes Files Only!";
 	
-	uint64 fin_size = static_cast<unsigned>(*fin_size_temp);
-	delete fin_size_temp;
+	size_t		n = o.also.size() + 1;
+	rawfile		fin;
+	rawfile*	outs = new rawfile[n];
+	rawpool		workers(o.crypto, o.threads);
+	rawfanout	fanout(workers);
 	
-	// Encrypt or Decrypt Loop
-	uint64	fin_offset = 0;
-	byte*	fin_buffer;
-	byte*	fout_buffer;
+	try {
+		if (fin.open(o.path1, rawfile::in, o.io) != B_OK) throw "Cannot Initialize Input File!";
+		if (outs[0].open(o.path2, rawfile::out, o.io) != B_OK) throw "Cannot Initialize Output File!";
+		fanout.add(o.crypto, outs[0]);
+		
+		for (size_t k = 1; k < n; ++k) {
+			// the key ends at the first ':', the rest names the output
+			string	key(o.also[k - 1], strchr(o.also[k - 1], ':') - o.also[k - 1]);
+			char*	path = strchr(o.also[k - 1], ':') + 1;
+			aes		other;
+			
+			rawaes_key(other, key.c_str(), o.key_size);
+			
+			if (outs[k].open(path, rawfile::out, o.io) != B_OK) throw "Cannot Initialize Output File!";
+			fanout.add(other, outs[k]);
+		}
+		
+		cout << "Encrypting for " << n << " keys...";
+		
+		fanout.run(fin);
+		
+		for (size_t k = 0; k < n; ++k) outs[k].sync();
+	} catch (...) {
+		delete[] outs;
+		throw;
+	}
 	
-	fin_buffer = new byte[17];
-	fout_buffer = new byte[17];
+	delete[] outs;
+	o.syncs.flush();
+}
+
+// Assemble Partial Containers Made With --range Into the Whole
+
+static void rawaes_merge(rawaes_opts& o)
+{
+	if (!o.dir_enc) throw "--merge Needs -e and the Key the Parts Were Made With!";
 	
-	typedef void (aes::* aes_encrypt_decrypt)(const byte[], byte[]);
+	rawbatch			list(o.io, true);
+	vector<rawfile*>	parts;
+	rawfile				fout;
+	rawcont				cont(o.crypto, o.key_size);
 	
-	aes_encrypt_decrypt aesfunc;
-	if (dir_enc) aesfunc = &aes::encrypt;
-	else aesfunc = &aes::decrypt;
+	list.read(o.path1, false);
 	
-	if (dir_enc) cout << "Encrypting...";
-	else cout << "Decrypting...";
+	try {
+		for (size_t k = 0; k < list.size(); ++k) {
+			parts.push_back(new rawfile);
+			if (parts[k]->open(list.files()[k].in.c_str(), rawfile::in, o.cio) != B_OK)
+				throw "Cannot Initialize Input File!";
+		}
+		
+		if (fout.open(o.path2, rawfile::out, o.cio) != B_OK) throw "Cannot Initialize Output File!";
+		
+		cout << "Merging " << parts.size() << " parts...";
+		
+		cont.merge(parts, fout);
+		fout.sync();
+	} catch (...) {
+		for (size_t k = 0; k < parts.size(); ++k) delete parts[k];
+		throw;
+	}
 	
-	while ((fin_size - fin_offset) >= 16) {
-		fin->Read(fin_buffer, 16);
-		(crypto.*aesfunc)(fin_buffer, fout_buffer);
-		fout->Write(fout_buffer, 16);
+	for (size_t k = 0; k < parts.size(); ++k) delete parts[k];
+	o.syncs.flush();
+}
+
+// Encrypt Into Parts, Each Written by Its Own Worker, or Join Them Again
+
+static void rawaes_shards(rawaes_opts& o)
+{
+	if (!o.dir_enc && o.shard_size != 0) throw "--shard-size Needs -e!";
+	if (o.container || o.partial || o.update || o.sum_kind != checksum::none)
+		throw "--shard-size Makes Plain rawaes Parts Only!";
+	
+	rawfile		fin;
+	rawfile		fout;
+	rawpool		workers(o.crypto, o.threads);
+	rawshard	shards(o.crypto, o.key_size, workers, o.io);
+	
+	if (o.dir_enc) {
+		if (fin.open(o.path1, rawfile::in, o.io) != B_OK) throw "Cannot Initialize Input File!";
+		
+		cout << "Encrypting...";
+		shards.split(fin, o.path2, o.shard_size);
+	}
+	else {
+		if (fout.open(o.path2, rawfile::out, o.io) != B_OK) throw "Cannot Initialize Output File!";
 		
-		fin_offset += 16;
+		cout << "Decrypting...";
+		shards.join(o.path1, fout);
+		fout.sync();
 	}
 	
-	int fin_rsize = fin_size - fin_offset;
-	if (fin_rsize != 0) {
-		for (int i = fin_rsize; i < 16; ++i) *(fin_buffer + i) = 0; 
+	o.syncs.flush();
+	
+	cout << shards.parts() << " parts...";
+}
+
+// Decrypt and Check, Writing Nothing
+
+static void rawaes_verify(rawaes_opts& o)
+{
+	if (o.dir_enc) throw "--verify Needs -d!";
+	
+	rawfile		fin;
+	rawfile		fref;
+	
+	if (fin.open(o.path1, rawfile::in, o.cio) != B_OK) throw "Cannot Initialize Input File!";
+	if (o.path2 != NULL && fref.open(o.path2, rawfile::in, o.cio) != B_OK)
+		throw "Cannot Initialize Reference File!";
+	
+	cout << "Verifying...";
+	
+	rawpool		workers(o.crypto, o.threads);
+	rawcont		cont(o.crypto, o.key_size);
+	rawverify	check(workers);
+	checksum	sum(o.sum_kind);
+	bool		chunked = rawcont::detect(fin);
+	
+	if (chunked) cont.open(fin);
+	
+	// only a container's hash tree checks anything without a
+	// reference file or --expect; a plain file would just decrypt
+	if (!chunked && o.path2 == NULL && o.expect == NULL)
+		throw "--verify Needs a reference_file or --expect Here!";
+	
+	check.run(fin, chunked ? &cont : NULL, o.path2 != NULL ? &fref : NULL,
+		sum.active() ? &sum : NULL);
+	
+	string	hex = sum.active() ? sum.hex() : string();
+	
+	if (o.expect != NULL && strcasecmp(o.expect, hex.c_str()) != 0)
+		throw "Verification Failed: Checksum Does Not Match!";
+	
+	cout << "Complete!\n";
+	
+	if (sum.active() && o.expect == NULL)
+		cout << sum.name() << " (" << o.path1 << ") = " << hex << "\n";
+}
+
+// Back Up Into, or Restore From, a Chunk Store
+
+static void rawaes_store(rawaes_opts& o)
+{
+	rawfile		fin;
+	rawfile		fout;
+	rawstore	chunks(o.crypto, o.key_size);
+	
+	chunks.open(o.store);
+	
+	// recipes and restored files are written a chunk at a time
+	if (fin.open(o.path1, rawfile::in) != B_OK) throw "Cannot Initialize Input File!";
+	if (fout.open(o.path2, rawfile::out, o.cio) != B_OK) throw "Cannot Initialize Output File!";
+	
+	if (o.dir_enc) {
+		cout << "Backing up...";
+		chunks.backup(fin, fout);
+		cout << chunks.added() << " of " << chunks.seen() << " chunks new...";
+	}
+	else {
+		cout << "Restoring...";
+		chunks.restore(fin, fout);
+	}
+	
+	fout.sync();
+	o.syncs.flush();
+}
+
+// Encrypt or Decrypt a Whole Directory Tree
+
+static void rawaes_tree(rawaes_opts& o)
+{
+	rawpool	workers(o.crypto, o.threads);
+	rawtree	tree(workers, o.io, o.dir_enc);
+	
+	if (o.dir_enc) cout << "Encrypting tree...";
+	else cout << "Decrypting tree...";
+	
+	tree.run(o.path1, o.path2);
+	o.syncs.flush();
+	
+	if (workers.failures() != 0) throw "Some Files Could Not Be Processed!";
+}
+
+// Overwrite Part of an Encrypted File in Place
+
+static void rawaes_update(rawaes_opts& o)
+{
+	if (!o.dir_enc) throw "--update Needs -e and the Plaintext to Write!";
+	
+	rawfile	fin;
+	rawfile	fout;
+	
+	if (fin.open(o.path1, rawfile::in, o.cio) != B_OK) throw "Cannot Initialize Input File!";
+	if (fout.open(o.path2, rawfile::update, o.cio) != B_OK) throw "Cannot Initialize Output File!";
+	
+	cout << "Updating...";
+	
+	rawcont		cont(o.crypto, o.key_size);
+	rawstream	stream(o.crypto, true);
+	bool		chunked = rawcont::detect(fout);
+	
+	if (chunked) cont.open(fout);
+	
+	uint64	want = (o.length < static_cast<uint64>(fin.size())) ? o.length : fin.size();
+	uint64	done = 0;
+	byte*	buf = o.pool.get();
+	
+	while (done < want) {
+		size_t part = (want - done < rawfile::buffer) ? want - done : static_cast<uint64>(rawfile::buffer);
+		
+		if (fin.read_at(buf, part, done) != part) throw "Input File Changed Size!";
 		
-		fin->Read(fin_buffer, fin_rsize);
-		(crypto.*aesfunc)(fin_buffer, fout_buffer);
-		fout->Write(fout_buffer, 16);
+		if (chunked) cont.update(o.crypto, fout, buf, part, o.offset + done);
+		else stream.patch(fout, buf, part, o.offset + done);
+		
+		done += part;
 	}
 	
-	fin->Unset();
-	fout->Unset();
+	o.pool.put(buf);
+	fout.sync();
+	o.syncs.flush();
+}
+
+// Encrypt or Decrypt a Chunked Container
+
+static void rawaes_container(rawaes_opts& o, rawfile& fin, rawfile& fout)
+{
+	rawpool		workers(o.crypto, o.threads);
+	rawcont		cont(o.crypto, o.key_size);
+	
+	cont.compress(o.compress);
 	
-	delete fout;
-	delete fin;
-	delete fout_buffer;
-	delete fin_buffer;
+	if (o.ranged) {
+		if (!o.dir_enc) throw "--range Needs -e!";
+		
+		cont.span(o.range_from, o.range_to);
+		
+		// every host derives the same nonce from the input as it is
+		struct stat	st;
+		if (stat(o.path1, &st) != 0) throw "Cannot Initialize Input File!";
+		
+		cont.bind_nonce(st.st_size,
+			static_cast<uint64>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec,
+			(o.job != NULL) ? o.job : "");
+	}
+	
+	if (o.checkpoint != 0) {
+		if (!o.dir_enc) throw "--checkpoint and --resume Need -e!";
+		
+		// the checkpoint is only good for the input as it was
+		struct stat	st;
+		if (stat(o.path1, &st) != 0) throw "Cannot Initialize Input File!";
+		
+		cont.checkpoint((string(o.path2) + ".ckpt").c_str(), st, o.checkpoint, o.resume);
+	}
+	
+	if (o.dir_enc && o.incremental) {
+		// the old sums go before the container changes, so a run that
+		// is cut short is followed by a full one
+		string	sums = string(o.path2) + ".sum";
+		bool	again = false;
+		
+		if (rawcont::detect(fout)) {
+			try {
+				cont.open(fout);
+				again = cont.chunk_mode() == o.cmode && cont.chunk() == o.chunk
+					&& cont.read_sums(sums.c_str());
+			} catch (const char*) {}
+		}
+		
+		unlink(sums.c_str());
+		cont.keep_sums(true);
+		
+		if (again) cont.refresh(fin, fout, workers);
+		else cont.create(fin, fout, o.cmode, o.chunk, workers);
+		
+		fout.sync();
+		cont.write_sums(sums.c_str());
+		
+		cout << cont.unchanged() << " of " << cont.chunks() << " chunks unchanged...";
+	}
+	else if (o.dir_enc) {
+		cont.create(fin, fout, o.cmode, o.chunk, workers);
+		
+		if (o.resume) cout << cont.resumed() << " of " << cont.chunks() << " chunks already done...";
+	}
+	else {
+		cont.open(fin);
+		cont.extract(fin, fout, workers, o.offset, o.length);
+	}
+}
+
+// Decrypt Just the Bytes Asked For, the Workers Reading Ahead
 
+static void rawaes_slice(rawaes_opts& o, rawfile& fin, rawfile& fout)
+{
+	rawpool		workers(o.crypto, o.threads);
+	rawreader	reader(o.crypto, o.key_size, fin, rawreader::shards, &workers);
+	
+	std::vector<byte>	buf(rawfile::buffer);
+	uint64	at = o.offset;
+	uint64	out = 0;
+	
+	while (out < o.length) {
+		// reads keep to whole buffers after the first, so each is
+		// one of the reader's chunks
+		uint64	want = rawfile::buffer - at % rawfile::buffer;
+		if (want > o.length - out) want = o.length - out;
+		
+		size_t	got = reader.pread(&buf[0], want, at);
+		if (got == 0) break;
+		
+		fout.write_at(&buf[0], got, out);
+		at += got;
+		out += got;
+	}
+	
+	fout.truncate(out);
+}
+
+// Encrypt or Decrypt One File, Whole or Chunked
+
+static void rawaes_file(rawaes_opts& o)
+{
+	rawfile	fin;
+	rawfile	fout;
+	
+	if (fin.open(o.path1, rawfile::in, o.cio) != B_OK) throw "Cannot Initialize Input File!";
+	if (!o.dir_enc && rawcont::detect(fin)) o.container = true;
+	if (o.partial && o.dir_enc) throw "--offset and --length Only Apply When Decrypting!";
+	if (!o.container && !o.partial && o.io.direct && fin.open(o.path1, rawfile::in, o.io) != B_OK)
+		throw "Cannot Initialize Input File!";
+	if ((o.incremental || o.resume) && o.dir_enc && fout.open(o.path2, rawfile::update, o.cio) == B_OK) {}
+	else if (fout.open(o.path2, rawfile::out, (o.container || o.partial) ? o.cio : o.io) != B_OK)
+		throw "Cannot Initialize Output File!";
+	
+	if (o.sum_kind != checksum::none && (o.container || o.partial))
+		throw "--sum Needs a Whole Plain rawaes File, Not a Container!";
+	
+	if (o.dir_enc) cout << "Encrypting...";
+	else cout << "Decrypting...";
+	
+	checksum	plain_sum(o.sum_plain ? o.sum_kind : checksum::none);
+	checksum	cipher_sum(o.sum_cipher ? o.sum_kind : checksum::none);
+	
+	if (o.container) rawaes_container(o, fin, fout);
+	else if (o.partial) rawaes_slice(o, fin, fout);
+	else {
+		// Encrypt or Decrypt the Whole File
+		rawstream	stream(o.crypto, o.dir_enc);
+		
+		stream.sums(plain_sum.active() ? &plain_sum : NULL, cipher_sum.active() ? &cipher_sum : NULL);
+		stream.run(fin, fout, o.pool);
+	}
+	
+	fout.sync();
+	
+	fin.unset();
+	fout.unset();
+	
+	o.syncs.flush();
+	
 	// Output Good News
 	cout << "Complete!\n";
 	
+	// Report Checksums, Tagged With the File Each Describes
+	if (o.sum_kind != checksum::none) {
+		string	report;
+		
+		if (plain_sum.active()) report += string(plain_sum.name()) + " (" + (o.dir_enc ? o.path1 : o.path2)
+			+ ") = " + plain_sum.hex() + "\n";
+		if (cipher_sum.active()) report += string(cipher_sum.name()) + " (" + (o.dir_enc ? o.path2 : o.path1)
+			+ ") = " + cipher_sum.hex() + "\n";
+		
+		if (o.sum_file == NULL) cout << report;
+		else {
+			rawfile	sums;
+			if (sums.open(o.sum_file, rawfile::out) != B_OK) throw "Cannot Write Checksum File!";
+			
+			sums.write_at(reinterpret_cast<const byte*>(report.data()), report.size(), 0);
+			sums.truncate(report.size());
+		}
+	}
+}
+
+int main(int argc, char** argv) try {
+	// Check Arguments For "--help" or "--version"
+	if (argc > 1) {
+		char* flag = *(argv + 1);
+		
+		if (strcmp("--help", flag) == 0) { cout << rawaes_menu; exit(0); }
+		if (strcmp("--version", flag) == 0) { cout << rawaes_version; exit(0); }
+	}
+	else { cout << rawaes_menu; exit(0); }
+	
+	rawaes_opts	o;
+	rawaes_parse(argc, argv, o);
+	
+	// Hand Over to the Mode Asked For; Each but the Last Reports Its Own
+	// Success, the Modes That Only Ever Throw on Failure Below
+	if (o.archive != NULL && o.dir_enc) rawaes_pack(o);
+	else if (o.archive != NULL) rawaes_unpack(o);
+	else if (o.manifest != NULL) rawaes_batch(o);
+	else if (o.newkey != NULL) rawaes_rekey(o);
+	else if (!o.also.empty()) rawaes_fanout(o);
+	else if (o.merge) rawaes_merge(o);
+	else if (o.shard_size != 0 || (!o.dir_enc && !o.verify && rawshard::detect(o.path1))) rawaes_shards(o);
+	else if (o.verify) { rawaes_verify(o); return 0; }
+	else if (o.store != NULL) rawaes_store(o);
+	else if (o.recurse) rawaes_tree(o);
+	else if (o.update) rawaes_update(o);
+	else { rawaes_file(o); return 0; }
+	
+	cout << "Complete!\n";
 	return 0;
 	
 } catch (const char* str) {
@@ -10,25 +10,116 @@
 |  distributed. The author assumes no responsibility     |
 |  for damaged caused due to the use of this program.    |
 |--------------------------------------------------------|
-| rawaes.h                                 (file 2 of 2) |
+| rawaes.h                                      (file 2) |
 |********************************************************/
 
 #if !defined(rawaes_h)
 #define rawaes_h
 
+#include <cctype>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <string>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 using namespace std;
 
 #include "aes.h"
-#include <be/storage/File.h>
+#include "rawarch.h"
+#include "rawbatch.h"
+#include "rawcont.h"
+#include "rawfanout.h"
+#include "rawfile.h"
+#include "rawhash.h"
+#include "rawlz.h"
+#include "rawpool.h"
+#include "rawreader.h"
+#include "rawrekey.h"
+#include "rawshard.h"
+#include "rawstore.h"
+#include "rawstream.h"
+#include "rawtree.h"
+#include "rawverify.h"
 #include <be/support/SupportDefs.h>
 
+// Everything the command line asks for, filled in by rawaes_parse() and
+// handed to whichever mode it names.  The policies point at syncs, so the
+// options are never copied.
+
+struct rawaes_opts
+{
+	char*		args[4];
+	int			argn;
+	char*		path1;		// input file
+	char*		path2;		// output file, or the reference file to verify against
+	bool		dir_enc;
+	int			key_size;
+	aes			crypto;
+
+	char*		manifest;
+	char*		archive;
+	char*		store;
+	bool		recurse;
+	bool		container;
+	rawcont::rawcont_mode	cmode;
+	uint32		chunk;
+	bool		partial;
+	bool		update;
+	bool		incremental;
+	bool		compress;
+	checksum::checksum_kind	sum_kind;
+	bool		sum_plain;
+	bool		sum_cipher;
+	char*		sum_file;
+	char*		expect;
+	bool		verify;
+	char*		newkey;
+	vector<char*>	also;
+	uint64		shard_size;
+	bool		ranged;
+	uint64		range_from;
+	uint64		range_to;
+	char*		job;
+	bool		merge;
+	int			checkpoint;
+	bool		resume;
+	uint64		offset;
+	uint64		length;
+	size_t		threads;
+
+	rawfile::policy	io;		// as asked for
+	rawfile::policy	cio;	// io through the page cache, made once io is known
+	rawsync		syncs;
+	rawbuffers	pool;
+
+	rawaes_opts(void);
+
+private:
+	rawaes_opts(const rawaes_opts&);
+	rawaes_opts&	operator=(const rawaes_opts&);
+};
+
 #define rawaes_menu \
 "Encrypts a file using Advanced Encryption Standard\n\
 AES uses Rijndael, a 128-bit block cipher, to encrypt\n\n\
-Usage: rawaes [-e|-d] key input_file output_file\n\n\
+Usage: rawaes [options] [-e|-d] key input_file output_file\n\
+       rawaes [options] [-e|-d] key --batch=manifest\n\
+       rawaes [options] -r [-e|-d] key input_dir output_dir\n\
+       rawaes [options] -e key --archive=archive --batch=manifest\n\
+       rawaes [options] -d key --archive=archive member output_file\n\
+       rawaes [options] -e key --store=dir input_file recipe_file\n\
+       rawaes [options] -d key --store=dir recipe_file output_file\n\
+       rawaes [options] --verify -d key input_file [reference_file]\n\
+       rawaes [options] --rekey=new_key -d key input_file output_file\n\
+       rawaes [options] -e key --also=key2:output2 input_file output_file\n\
+       rawaes [options] -e key --shard-size=MB input_file manifest\n\
+       rawaes [options] -e key --range=i:j input_file part_file\n\
+       rawaes [options] -e key --merge part_list output_file\n\n\
 key: bits used to encrypt file; up 128 bits (16 characters)\n\
 input_file: path of the input data\n\
 output_file: path to place output data\n\n\
@@ -39,6 +130,81 @@ options:\n\
   -d, -d16, -d128     decrypt the input file, 128-bit key\n\
       -d24, -d192                           , 192-bit key\n\
       -d32, -d256                           , 256-bit key\n\n\
+      --direct        bypass the page cache where supported (O_DIRECT)\n\
+      --cache=keep    leave page caching to the system (default)\n\
+      --cache=sequential  read ahead of sequential access\n\
+      --cache=drop    read ahead and drop pages once used\n\n\
+      --sync=none     give no durability guarantee (default)\n\
+      --sync=file     fdatasync the output once it is written\n\
+      --sync=periodic[:MB]  as file, starting writeback every MB (64)\n\
+      --sync=batch    sync outputs together at the end of the batch\n\n\
+      --batch=manifest  process every file listed in manifest, one per\n\
+                      line as \"input<TAB>output\" or just \"input\" (to\n\
+                      input.aes, or back again); \"-\" reads stdin\n\n\
+      --archive=file  pack the files in the manifest into one archive,\n\
+                      named as listed (\"input<TAB>name\" renames them);\n\
+                      with -d extract a member, or every member listed\n\
+                      in the manifest (\"member<TAB>output\")\n\n\
+      --store=dir     back input_file up into a chunk store, storing\n\
+                      only chunks it does not hold yet, and write the\n\
+                      recipe to rebuild it; with -d rebuild the file\n\n\
+  -r                  mirror a whole directory tree into output_dir,\n\
+                      keeping permissions and timestamps\n\
+      --container     encrypt into a seekable container of chunks, each\n\
+                      sealed on its own; found again when decrypting\n\
+      --mode=ctr      container chunks in counter mode, exact length\n\
+                      (default)\n\
+      --mode=ecb      container chunks in ECB mode, as plain rawaes\n\
+      --chunk=KB      container chunk size, 4 to 1024 (default 1024)\n\
+      --compress      as --container, compressing each chunk before it\n\
+                      is encrypted where that makes it smaller\n\
+      --range=i:j     as --container, encrypting only chunks i to j - 1\n\
+                      of input_file into a partial container, so one\n\
+                      file can be encrypted on several hosts at once\n\
+      --job=name      with --range, a name for this run, the same on\n\
+                      every host; in CTR mode the parts take their\n\
+                      nonce from the key, the job and input_file's\n\
+                      length and modification time, which must match\n\
+                      on every host\n\
+      --merge         make output_file the whole container from the\n\
+                      partial containers listed in part_list, one per\n\
+                      line, copying their chunks without decrypting\n\
+      --incremental   as --container, keeping chunk fingerprints in\n\
+                      output_file.sum; a later run rewrites only the\n\
+                      chunks that changed\n\
+      --checkpoint[=S] with a container, save progress to\n\
+                      output_file.ckpt every S seconds (default 30)\n\
+      --resume        as --checkpoint, carrying on from the chunks\n\
+                      output_file.ckpt records as done\n\
+      --offset=N      decrypt only from byte N of the plaintext onwards,\n\
+                      reading just the blocks or chunks needed\n\
+      --length=N      decrypt at most N bytes of plaintext\n\
+      --sum=xxh64, --sum=crc32c, --sum=sha256\n\
+                      checksum the data on its way through, in the\n\
+                      same pass, and print it as \"NAME (file) = hex\"\n\
+      --sum-of=plain  checksum the plaintext (default)\n\
+      --sum-of=cipher checksum the ciphertext\n\
+      --sum-of=both   checksum both\n\
+      --sum-file=path write the checksums to path instead\n\
+      --verify        decrypt and check input_file, writing nothing: a\n\
+                      container against its hash tree, and the plaintext\n\
+                      against reference_file and --expect if given; a\n\
+                      plain file needs one of them\n\
+      --expect=hex    with --verify, the --sum the plaintext must have\n\
+      --also=key:file with -e, also encrypt input_file to file under\n\
+                      key, reading the input once; may be repeated\n\
+      --shard-size=MB with -e, write the output as parts of MB each,\n\
+                      manifest.000 onwards, in parallel, listed in\n\
+                      manifest; each part decrypts on its own, and\n\
+                      decrypting manifest joins them\n\
+      --rekey=new_key decrypt with key and encrypt with new_key in one\n\
+                      pass, in memory; output_file may be input_file,\n\
+                      which is replaced once the new copy is on disk\n\
+      --update        with -e, write input_file over the plaintext of the\n\
+                      existing output_file at --offset, in place\n\
+      --threads=N     worker threads for -r, --batch and --container\n\
+                      (default: one per CPU); large files are split\n\
+                      between them\n\n\
       --help          displays this text and exits\n\
       --version       displays version and exits\n"
       
@@ -0,0 +1,306 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawarch.cpp                                   (file 3) |
+|********************************************************/
+
+#include "rawarch.h"
+#include "rawstream.h"
+
+#include <cstring>
+
+static const char	rawarch_magic[] = "rawaesA1";
+static const char	rawarch_index[] = "rawaesI1";
+
+class rawarch_packer : public rawtask
+{
+public:
+	rawarch_packer(rawarch& a) : arch(a) {};
+	void	run(rawworker& w) { arch.pack(w); };
+
+private:
+	rawarch&	arch;
+};
+
+// Each packer takes the next file in list order and streams it, a buffer
+// at a time, into the reorder buffer.  Taking files strictly in order is
+// what guarantees that the oldest unfinished member is always being worked
+// on, so the packers can never all be waiting on one another.
+
+void rawarch::create(rawfile& out, const std::vector<rawbatch::entry>& list,
+	const rawfile::policy& io, rawpool& workers)
+{
+	byte	head[header];
+	byte	zero[rawfile::block];
+
+	memset(head, 0, sizeof(head));
+	memset(zero, 0, sizeof(zero));
+	memcpy(head, rawarch_magic, 8);
+	uint32_out(head + 8, version);
+	uint32_out(head + 12, key_bits);
+	crypto.encrypt(zero, head + 16);
+
+	out.write_at(head, header, 0);
+
+	rawreorder reorder(out, header, window, workers.buffers());
+
+	files = &list;
+	input = io;
+	order = &reorder;
+	claimed = 0;
+	lengths.assign(list.size(), 0);
+	packed.assign(list.size(), 0);
+
+	for (size_t i = 0; i < workers.size(); ++i) workers.push(new rawarch_packer(*this));
+	workers.wait();
+
+	order = NULL;
+	if (error != NULL) throw error;
+
+	// the index, encrypted like the members
+	std::vector<byte> index;
+
+	members.clear();
+	for (size_t i = 0; i < list.size(); ++i) {
+		if (!packed[i]) continue;
+
+		member m;
+		m.name = list[i].out;
+		m.offset = reorder.offset(i);
+		m.length = lengths[i];
+		members.push_back(m);
+
+		byte entry[20];
+		uint64_out(entry, m.offset);
+		uint64_out(entry + 8, m.length);
+		uint32_out(entry + 16, m.name.size());
+		index.insert(index.end(), entry, entry + 20);
+		index.insert(index.end(), m.name.begin(), m.name.end());
+	}
+
+	uint64 ilen = index.size();
+	index.resize(rawstream::padded(ilen + 1), 0);	// never empty
+
+	rawstream stream(crypto, true);
+	stream.crypt(&index[0], index.size());
+
+	off_t at = reorder.end();
+	out.write_at(&index[0], index.size(), at);
+
+	byte tail[trailer];
+	memset(tail, 0, sizeof(tail));
+	memcpy(tail, rawarch_index, 8);
+	uint64_out(tail + 8, at);
+	uint64_out(tail + 16, ilen);
+	uint64_out(tail + 24, members.size());
+
+	out.write_at(tail, trailer, at + index.size());
+	out.truncate(at + index.size() + trailer);
+}
+
+void rawarch::pack(rawworker& w)
+{
+	rawbuffers&	pool = w.pool->buffers();
+	rawstream	stream(w.crypto, true);
+
+	for (;;) {
+		uint64 m = __sync_fetch_and_add(&claimed, 1);
+		if (m >= files->size()) return;
+
+		const rawbatch::entry& e = (*files)[m];
+		const char* fail = NULL;
+		bool ended = false;
+
+		try {
+			rawfile fin;
+			if (fin.open(e.in.c_str(), rawfile::in, input) != B_OK) throw "Cannot Initialize Input File!";
+
+			for (off_t pos = 0; !ended; ) {
+				byte* buf = pool.get();
+				size_t got;
+
+				try {
+					got = fin.read_at(buf, rawfile::buffer, pos);
+				} catch (...) {
+					pool.put(buf);
+					throw;
+				}
+
+				size_t psize = rawstream::padded(got);
+				for (size_t i = got; i < psize; ++i) buf[i] = 0;
+				stream.crypt(buf, psize);
+
+				ended = (got < rawfile::buffer);
+				lengths[m] += got;
+				pos += got;
+
+				try {
+					order->put(m, buf, psize, ended);
+				} catch (const char* str) {
+					__sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), str);
+					return;
+				}
+			}
+		} catch (const char* str) {
+			fail = str;
+		}
+
+		if (fail != NULL) {
+			w.pool->fail(e.in, fail);
+
+			// end the member so those after it can still be written; its
+			// partial contents stay in the archive but not in the index
+			if (!ended) {
+				try { order->put(m, NULL, 0, true); }
+				catch (const char* str) {
+					__sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), str);
+					return;
+				}
+			}
+		}
+		else packed[m] = 1;
+	}
+}
+
+void rawarch::open(rawfile& in)
+{
+	byte	head[header];
+	byte	tail[trailer];
+	byte	check[rawfile::block];
+
+	off_t size = in.size();
+	if (size < header + trailer
+		|| in.read_at(head, header, 0) != header
+		|| in.read_at(tail, trailer, size - trailer) != trailer
+		|| memcmp(head, rawarch_magic, 8) != 0
+		|| memcmp(tail, rawarch_index, 8) != 0) throw "Not a rawaes Archive!";
+
+	if (uint32_in(head + 8) != version) throw "Unsupported Archive Version!";
+	if (static_cast<int>(uint32_in(head + 12)) != key_bits) throw "Archive Uses a Different Key Size!";
+
+	crypto.decrypt(head + 16, check);
+	for (int i = 0; i < rawfile::block; ++i) if (check[i] != 0) throw "Wrong Key for Archive!";
+
+	uint64 at = uint64_in(tail + 8);
+	uint64 ilen = uint64_in(tail + 16);
+	uint64 count = uint64_in(tail + 24);
+	uint64 plen = rawstream::padded(ilen + 1);
+
+	if (at < header || plen > static_cast<uint64>(size - trailer) - at) throw "Archive Index Is Damaged!";
+
+	std::vector<byte> index(plen);
+	if (in.read_at(&index[0], plen, at) != plen) throw "Archive Index Is Damaged!";
+
+	rawstream stream(crypto, false);
+	stream.crypt(&index[0], plen);
+
+	members.clear();
+	for (uint64 i = 0, pos = 0; i < count; ++i) {
+		if (ilen - pos < 20) throw "Archive Index Is Damaged!";
+
+		member m;
+		m.offset = uint64_in(&index[pos]);
+		m.length = uint64_in(&index[pos + 8]);
+		uint32 nlen = uint32_in(&index[pos + 16]);
+		pos += 20;
+
+		if (ilen - pos < nlen || m.offset > at || m.length > at - m.offset
+			|| static_cast<uint64>(rawstream::padded(m.length)) > at - m.offset)
+			throw "Archive Index Is Damaged!";
+
+		m.name.assign(reinterpret_cast<char*>(&index[pos]), nlen);
+		pos += nlen;
+		members.push_back(m);
+	}
+}
+
+const rawarch::member* rawarch::find(const std::string& name) const
+{
+	for (size_t i = 0; i < members.size(); ++i) if (members[i].name == name) return &members[i];
+
+	return NULL;
+}
+
+// Reads and decrypts only the blocks belonging to m.
+
+void rawarch::extract(aes& schedule, const member& m, rawfile& in, rawfile& out, rawbuffers& pool)
+{
+	rawstream	stream(schedule, false);
+	byte*		buf = pool.get();
+
+	try {
+		out.preallocate(m.length);
+
+		for (uint64 pos = 0; pos < m.length; ) {
+			size_t len = rawfile::buffer;
+			if (m.length - pos < len) len = m.length - pos;
+
+			size_t psize = rawstream::padded(len);
+			if (in.read_at(buf, psize, m.offset + pos) != psize) throw "Archive Member Is Damaged!";
+
+			stream.crypt(buf, psize);
+			out.write_at(buf, len, pos);
+			pos += len;
+		}
+
+		out.truncate(m.length);
+	} catch (...) {
+		pool.put(buf);
+		throw;
+	}
+
+	pool.put(buf);
+}
+
+class rawarch_extract : public rawtask
+{
+public:
+	rawarch_extract(rawarch& a, rawfile& f, const rawarch::member& m, const std::string& o,
+		const rawfile::policy& p) : arch(a), in(f), from(m), out(o), io(p) {};
+	void	run(rawworker& w);
+
+private:
+	rawarch&				arch;
+	rawfile&				in;
+	const rawarch::member&	from;
+	std::string				out;
+	rawfile::policy			io;
+};
+
+void rawarch_extract::run(rawworker& w)
+{
+	try {
+		rawfile fout;
+		if (fout.open(out.c_str(), rawfile::out, io) != B_OK) throw "Cannot Initialize Output File!";
+
+		arch.extract(w.crypto, from, in, fout, w.pool->buffers());
+		fout.sync();
+	} catch (const char* str) {
+		w.pool->fail(from.name, str);
+	}
+}
+
+// Extracts every member named in list, as many at once as there are
+// workers.  The entries name a member and the file to extract it to.
+
+void rawarch::extract(rawfile& in, const std::vector<rawbatch::entry>& list,
+	const rawfile::policy& io, rawpool& workers)
+{
+	for (size_t i = 0; i < list.size(); ++i) {
+		const member* m = find(list[i].in);
+
+		if (m == NULL) workers.fail(list[i].in, "No Such Archive Member!");
+		else workers.push(new rawarch_extract(*this, in, *m, list[i].out, io));
+	}
+
+	workers.wait();
+}
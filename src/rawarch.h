@@ -0,0 +1,90 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawarch.h                                     (file 4) |
+|********************************************************/
+
+#if !defined(rawarch_h)
+#define rawarch_h
+
+#include <string>
+#include <vector>
+
+#include "aes.h"
+#include "rawbatch.h"
+#include "rawfile.h"
+#include "rawpool.h"
+#include "rawreorder.h"
+#include <be/support/SupportDefs.h>
+
+// An archive packs many encrypted files into one file that is written
+// front to back.  Every number is little endian.
+//
+//   header    48 bytes:  "rawaesA1", version (4), key bits (4),
+//                        the encrypted zero block (16), reserved (16)
+//   members   the padded ciphertext of each file, back to back
+//   index     the ciphertext of the member list, padded to a block; for
+//             each member: offset (8), length (8), name length (4), name
+//   trailer   32 bytes:  "rawaesI1", index offset (8), index length (8),
+//                        member count (8)
+//
+// The index records every member's exact length and where it starts, so
+// one member can be read back without touching any other.
+
+class rawarch
+{
+public:
+	enum rawarch_const	{	header = 48,
+							trailer = 32,
+							version = 1,
+							window = 64		// pieces held for reordering
+						};
+
+	struct member
+	{
+		std::string	name;
+		uint64		offset;
+		uint64		length;		// plaintext bytes
+	};
+
+	rawarch(aes& c, const int bits) : crypto(c), key_bits(bits), claimed(0),
+		files(NULL), order(NULL), error(NULL) {};
+
+	void		create(rawfile& out, const std::vector<rawbatch::entry>& list,
+					const rawfile::policy& io, rawpool& workers);
+	void		pack(rawworker& w);
+
+	void		open(rawfile& in);
+	const member*	find(const std::string& name) const;
+	void		extract(aes& schedule, const member& m, rawfile& in, rawfile& out, rawbuffers& pool);
+	void		extract(rawfile& in, const std::vector<rawbatch::entry>& list,
+					const rawfile::policy& io, rawpool& workers);
+
+	size_t		size(void) const	{ return members.size(); };
+
+private:
+	aes&		crypto;		// encrypts the index, or decrypts it
+	int			key_bits;
+
+	std::vector<member>		members;
+
+	// used while packing
+	uint64		claimed;	// the next file for a worker to take
+	const std::vector<rawbatch::entry>*	files;
+	rawfile::policy	input;	// how packed files are read
+	rawreorder*	order;
+	std::vector<uint64>	lengths;
+	std::vector<char>	packed;	// 1 if a file made it into the archive
+	const char*	error;		// a failure of the archive itself
+};
+
+#endif
@@ -0,0 +1,176 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawbatch.cpp                                  (file 5) |
+|********************************************************/
+
+#include "rawbatch.h"
+#include "rawjob.h"
+#include "rawstream.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+void rawbatch::add(const std::string& in, const std::string& out)
+{
+	entry e;
+
+	e.in = in;
+	e.out = out;
+	entries.push_back(e);
+}
+
+// The manifest holds one file per line, either "input<TAB>output" or just
+// the input.  A lone input is written next to itself with ".aes" added, or
+// removed when decrypting, unless derive is false, in which case it stands
+// for both.  Blank lines and lines starting with '#' are skipped, and "-"
+// reads the manifest from standard input.
+
+void rawbatch::read(const char* manifest, const bool derive)
+{
+	FILE* f = (strcmp(manifest, "-") == 0) ? stdin : fopen(manifest, "r");
+	if (f == NULL) throw "Cannot Read Batch Manifest!";
+
+	const std::string	suffix = rawbatch_suffix;
+	std::string			line;
+	int					c;
+
+	do {
+		c = fgetc(f);
+
+		if (c != '\n' && c != EOF) { line += static_cast<char>(c); continue; }
+		if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+		if (line.empty() || line[0] == '#') { line.clear(); continue; }
+
+		std::string::size_type tab = line.find('\t');
+
+		if (tab != std::string::npos) add(line.substr(0, tab), line.substr(tab + 1));
+		else if (!derive) add(line, line);
+		else if (enc) add(line, line + suffix);
+		else if (line.size() > suffix.size()
+			&& line.compare(line.size() - suffix.size(), suffix.size(), suffix) == 0)
+			add(line, line.substr(0, line.size() - suffix.size()));
+		else add(line, line + ".dec");
+
+		line.clear();
+	} while (c != EOF);
+
+	if (f != stdin) fclose(f);
+}
+
+void* rawbatch::opener(void* data)
+{
+	static_cast<rawbatch*>(data)->open_all();
+	return NULL;
+}
+
+void rawbatch::open_all(void)
+{
+	for (size_t i = 0; i < entries.size(); ++i) {
+		pthread_mutex_lock(&lock);
+		while (opened - taken >= ahead) pthread_cond_wait(&cond, &lock);
+		pthread_mutex_unlock(&lock);
+
+		slot& s = slots[i % ahead];
+
+		s.error = NULL;
+		if (s.fin.open(entries[i].in.c_str(), rawfile::in, io) != B_OK)
+			s.error = "Cannot Initialize Input File!";
+		else if (s.fout.open(entries[i].out.c_str(), rawfile::out, io) != B_OK)
+			s.error = "Cannot Initialize Output File!";
+		else s.fout.preallocate(rawstream::padded(s.fin.size()));
+
+		pthread_mutex_lock(&lock);
+		++opened;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+// Files that fail are reported and counted, and the batch carries on with
+// the rest of the list.
+
+void rawbatch::run(const aes& crypto, rawbuffers& pool)
+{
+	aes schedule = crypto;
+
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&cond, NULL);
+	opened = 0;
+	taken = 0;
+
+	pthread_t helper;
+	if (pthread_create(&helper, NULL, opener, this) != 0) throw "Cannot Start Thread!";
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+		pthread_mutex_lock(&lock);
+		while (opened <= i) pthread_cond_wait(&cond, &lock);
+		pthread_mutex_unlock(&lock);
+
+		slot& s = slots[i % ahead];
+
+		try {
+			if (s.error != NULL) throw s.error;
+
+			rawstream stream(schedule, enc);
+			stream.run(s.fin, s.fout, pool);
+			s.fout.sync();
+		} catch (const char* str) {
+			std::cout << std::endl << entries[i].in << ": " << str;
+			++failed;
+		}
+
+		s.fin.unset();
+		s.fout.unset();
+
+		pthread_mutex_lock(&lock);
+		++taken;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+	}
+
+	pthread_join(helper, NULL);
+
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&lock);
+
+	if (failed != 0) std::cout << std::endl;
+}
+
+// With more than one thread every file becomes a pool task.  Large files
+// are split further by rawjob, so one huge file among many small ones
+// still keeps every worker busy.
+
+class rawbatch_file : public rawtask
+{
+public:
+	rawbatch_file(const rawbatch::entry& e, const rawfile::policy& p, const bool c)
+		: file(e), io(p), enc(c) {};
+	void	run(rawworker& w) { rawjob::start(w, file.in, file.out, io, enc, NULL); };
+
+private:
+	rawbatch::entry		file;
+	rawfile::policy		io;
+	bool				enc;
+};
+
+void rawbatch::run(rawpool& workers)
+{
+	for (size_t i = 0; i < entries.size(); ++i)
+		workers.push(new rawbatch_file(entries[i], io, enc));
+
+	workers.wait();
+
+	failed = workers.failures();
+	if (failed != 0) std::cout << std::endl;
+}
@@ -0,0 +1,81 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawbatch.h                                    (file 6) |
+|********************************************************/
+
+#if !defined(rawbatch_h)
+#define rawbatch_h
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawpool.h"
+#include <be/support/SupportDefs.h>
+
+#define rawbatch_suffix ".aes"
+
+// rawbatch encrypts or decrypts a list of files in one process.  The key
+// schedule is expanded once by the caller and the I/O buffers are shared
+// between files.  Run on a single thread, a helper thread is opening the
+// files that follow while one file is being processed; run on a pool, the
+// files are spread over its workers.
+
+class rawbatch
+{
+public:
+	enum rawbatch_const	{	ahead = 4	};	// files opened ahead of time
+
+	struct entry
+	{
+		std::string	in;			// input path
+		std::string	out;		// output path
+	};
+
+	rawbatch(const rawfile::policy& p, const bool e) : io(p), enc(e), failed(0) {};
+
+	void		add(const std::string& in, const std::string& out);
+	void		read(const char* manifest, const bool derive = true);
+	void		run(const aes& crypto, rawbuffers& pool);	// one file at a time
+	void		run(rawpool& workers);						// many files at once
+
+	size_t		size(void) const	{ return entries.size(); };
+	const std::vector<entry>&	files(void) const	{ return entries; };
+	size_t		failures(void) const	{ return failed; };
+
+private:
+	struct slot					// one pair of files opened ahead
+	{
+		rawfile		fin;
+		rawfile		fout;
+		const char*	error;		// why the pair could not be opened
+	};
+
+	rawfile::policy		io;
+	bool				enc;
+	size_t				failed;
+	std::vector<entry>	entries;
+
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	size_t				opened;	// entries opened by the helper
+	size_t				taken;	// entries finished by the main thread
+	slot				slots[ahead];
+
+	static void*		opener(void* data);
+	void				open_all(void);
+};
+
+#endif
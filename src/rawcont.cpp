@@ -0,0 +1,1343 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawcont.cpp                                   (file 7) |
+|********************************************************/
+
+#include "rawcont.h"
+#include "rawlz.h"
+#include "rawstream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+static const char	rawcont_magic[] = "rawaesC1";
+static const char	rawcont_footer[] = "rawaesF1";
+static const char	rawcont_sums[] = "rawaesS1";
+static const char	rawcont_label[] = "rawaes chunk sum";
+static const char	rawcont_root[] = "rawaes tree root";
+static const char	rawcont_job[] = "rawaes range job";
+static const char	rawcont_ckpt[] = "rawaesP1";
+
+class rawcont_worker : public rawtask
+{
+public:
+	rawcont_worker(rawcont& c) : cont(c) {};
+	void	run(rawworker& w) { cont.work(w); };
+
+private:
+	rawcont&	cont;
+};
+
+rawcont::rawcont(aes& c, const int bits)
+	: crypto(c), key_bits(bits), mode(ctr), flags(0), csize(chunk_size), olen(0), rounds(0),
+	first(0), held(0), spanning(false), fixed(false),
+	tree_at(0), leaves(&tree), reused(0), summing(false), packing(false), holes(false),
+	ckpt_every(0), resuming(false), ckpt(NULL), done(0), counted(0),
+	reach(header), generation(0), skipped(0), saved(0), src(NULL), dst(NULL),
+	sealing(true), renew(NULL), claimed(0), last(0), tail(header),
+	from(0), to(0), error(NULL)
+{
+	memset(nonce, 0, sizeof(nonce));
+	memset(front, 0, sizeof(front));
+	memset(tag, 0, sizeof(tag));
+	memset(ckpt_stamp, 0, sizeof(ckpt_stamp));
+	memset(root_key, 0, sizeof(root_key));
+
+	pthread_mutex_init(&done_lock, NULL);
+	pthread_mutex_init(&save_lock, NULL);
+}
+
+rawcont::~rawcont(void)
+{
+	delete ckpt;
+
+	pthread_mutex_destroy(&done_lock);
+	pthread_mutex_destroy(&save_lock);
+}
+
+bool rawcont::detect(rawfile& in)
+{
+	byte	head[8];
+	byte	tail[8];
+
+	return in.size() >= header + trailer
+		&& in.read_at(head, 8, 0) == 8
+		&& in.read_at(tail, 8, in.size() - trailer) == 8
+		&& memcmp(head, rawcont_magic, 8) == 0
+		&& memcmp(tail, rawcont_footer, 8) == 0;
+}
+
+// The nonce only has to be unique per key; the low half is left 0 so the
+// block counter never carries into the random half.
+
+static void make_nonce(byte nonce[])
+{
+	memset(nonce, 0, rawfile::block);
+
+	FILE* f = fopen("/dev/urandom", "rb");
+	if (f == NULL || fread(nonce, 1, 8, f) != 8) {
+		if (f != NULL) fclose(f);
+		throw "Cannot Generate a Nonce!";
+	}
+
+	fclose(f);
+}
+
+// The nonce for a chunk of the given round.  Rounds only change the random
+// half, so the counters of different chunks still never overlap.
+
+static void chunk_nonce(const byte nonce[], const uint64 round, byte out[])
+{
+	memcpy(out, nonce, rawfile::block);
+	for (int j = 0; j < 8; ++j) out[j] ^= static_cast<byte>(round >> (8 * j));
+}
+
+void rawcont::create(rawfile& in, rawfile& out, const rawcont_mode m, const uint32 chunk,
+	rawpool& workers)
+{
+	mode = m;
+	flags = hashed | (packing ? compressed : 0) | (spanning ? partial : 0);
+	csize = chunk;
+	olen = in.size();
+	rounds = 0;
+
+	if (csize == 0 || csize % rawfile::block != 0 || csize > chunk_size) throw "Invalid Chunk Size!";
+	if (mode == ecb) memset(nonce, 0, sizeof(nonce));
+	else if (!fixed) make_nonce(nonce);
+
+	uint64 n = total();
+
+	if (!spanning) {
+		first = 0;
+		held = n;
+	}
+	else if (held > n) held = n;
+
+	if (first > held) throw "Range Starts Past the End of the File!";
+
+	index.assign(held - first, chunk_info());
+	holes = in.sparse();
+	done = 0;
+	skipped = 0;
+
+	if (!ckpt_path.empty()) start_ckpt();
+	layout(out);
+	if (ckpt != NULL && resuming) load_ckpt(out);
+
+	prior.clear();
+	reused = 0;
+
+	try {
+		run(in, out, true, first + done, held, workers);
+	} catch (...) {
+		// what was finished is kept for a later run to resume from
+		if (ckpt != NULL) try { save(out); } catch (const char*) {}
+		throw;
+	}
+
+	write_index(out);
+
+	if (ckpt != NULL) {
+		// the checkpoint goes only once the container is whole on disk
+		out.datasync();
+		delete ckpt;
+		ckpt = NULL;
+		unlink(ckpt_path.c_str());
+	}
+}
+
+// Makes create() write only chunks [start, end) of the input, as a partial
+// container to be merged with the others later.
+
+void rawcont::span(const uint64 start, const uint64 end)
+{
+	first = start;
+	held = end;
+	spanning = true;
+}
+
+// Every partial container of one file needs the same nonce, yet no nonce
+// may be used again for other plaintext.  So each host hashes a secret
+// from the key with the input's length, its modification time (stamp)
+// and the job name into the random half, rather than making its own or
+// being given one.  merge() refuses parts whose nonces differ.
+
+void rawcont::bind_nonce(const uint64 size, const uint64 stamp, const std::string& job)
+{
+	byte	secret[rawfile::block];
+	byte	input[16];
+	byte	sum[sha256::size];
+	sha256	hash;
+
+	crypto.encrypt(reinterpret_cast<const byte*>(rawcont_job), secret);
+	uint64_out(input, size);
+	uint64_out(input + 8, stamp);
+
+	hash.update(secret, sizeof(secret));
+	hash.update(input, sizeof(input));
+	hash.update(reinterpret_cast<const byte*>(job.data()), job.size());
+	hash.final(sum);
+
+	memset(nonce, 0, sizeof(nonce));
+	memcpy(nonce, sum, 8);
+	fixed = true;
+}
+
+// Brings a container opened with open() up to date with in, which may have
+// changed length.  Every chunk has a fixed place, so a chunk whose
+// fingerprint matches the one in the sums read by read_sums() is left as
+// it is; only the others, the header and the index are written.  The
+// others are encrypted in a new round, which is on disk before any of them.
+
+void rawcont::refresh(rawfile& in, rawfile& out, rawpool& workers)
+{
+	uint64 before = index.size();
+
+	// compressed chunks have no fixed place to be rewritten in
+	if (flags & compressed) throw "Cannot Refresh a Compressed Container!";
+
+	summing = true;
+	olen = in.size();
+
+	// a chunk can only be left alone if its leaf of the tree is known
+	if (prior.size() != before * sha256::size) prior.clear();
+
+	uint64 n = total();
+	index.resize(n, chunk_info());
+	held = n;
+	holes = in.sparse();
+
+	++rounds;
+	layout(out);
+	out.datasync();
+
+	reused = 0;
+	run(in, out, true, 0, n, workers);
+
+	write_index(out);
+}
+
+// Writes the header.  Every chunk but the last is full, so each has a
+// fixed place, given by place(); compressed chunks are placed as they are
+// written instead, unless they are already in place.
+
+void rawcont::layout(rawfile& out)
+{
+	layout(out, crypto);
+}
+
+void rawcont::layout(rawfile& out, aes& schedule)
+{
+	uint64 n = index.size();
+
+	byte	zero[rawfile::block];
+
+	memset(front, 0, sizeof(front));
+	memset(zero, 0, sizeof(zero));
+	memcpy(front, rawcont_magic, 8);
+	uint32_out(front + 8, version);
+	uint32_out(front + 12, mode);
+	uint32_out(front + 16, key_bits);
+	uint32_out(front + 20, flags);
+	uint32_out(front + 24, csize);
+	uint64_out(front + 32, olen);
+	memcpy(front + 40, nonce, sizeof(nonce));
+	schedule.encrypt(zero, front + 56);
+	uint64_out(front + 72, first);
+	uint64_out(front + 80, rounds);
+	schedule.encrypt(reinterpret_cast<const byte*>(rawcont_root), root_key);
+
+	// how far a compressed container reaches is not known until the end,
+	// and reserving the holes of a sparse one would fill them in
+	if (!(flags & compressed) && !holes && n != 0) {
+		uint64 plain = (held < total()) ? csize : olen - (held - 1) * csize;
+		uint64 end = place(held - 1) + chunk_header + rawstream::padded(plain);
+		out.preallocate(end + n * entry + trailer);
+	}
+
+	tail = header;
+	out.write_at(front, header, 0);
+
+	sums.assign(summing ? n * sha256::size : 0, 0);
+	plant(n);
+}
+
+void rawcont::write_index(rawfile& out)
+{
+	uint64 n = index.size();
+
+	grow();
+	root_tag(tag);
+
+	size_t nodes = tree.size() + sha256::size;
+
+	std::vector<byte> list(n * entry + nodes + trailer, 0);
+	for (uint64 i = 0; i < n; ++i) {
+		byte* e = &list[i * entry];
+
+		uint64_out(e, index[i].offset);
+		uint32_out(e + 8, index[i].plain);
+		uint32_out(e + 12, index[i].stored);
+		uint32_out(e + 16, index[i].flags);
+		uint32_out(e + 20, index[i].squeezed);
+		uint64_out(e + 24, index[i].round);
+	}
+
+	uint64 end = header;
+	for (uint64 i = 0; i < n; ++i)
+		if (!(index[i].flags & hole) && index[i].offset + chunk_header + index[i].stored > end)
+			end = index[i].offset + chunk_header + index[i].stored;
+	tree_at = end + n * entry;
+
+	memcpy(&list[n * entry], tag, sha256::size);
+	if (!tree.empty()) memcpy(&list[n * entry + sha256::size], &tree[0], tree.size());
+
+	byte* tail = &list[n * entry + nodes];
+	memcpy(tail, rawcont_footer, 8);
+	uint64_out(tail + 8, end);
+	uint64_out(tail + 16, n);
+	uint64_out(tail + 24, olen);
+	uint64_out(tail + 32, tree_at);
+	uint64_out(tail + 40, first);
+
+	out.write_at(&list[0], list.size(), end);
+	out.truncate(end + list.size());
+}
+
+// Sizes the tree for n chunks.  The leaves already there are kept, up to n.
+
+void rawcont::plant(const uint64 n)
+{
+	levels.clear();
+
+	uint64 at = 0;
+	for (uint64 count = n; count != 0; count = (count == 1) ? 0 : (count + 1) / 2) {
+		levels.push_back(at);
+		at += count;
+	}
+	levels.push_back(at);
+
+	tree.resize(at * sha256::size);
+}
+
+static void tree_node(const byte left[], const byte right[], byte out[])
+{
+	byte	inner = 1;
+	sha256	hash;
+
+	hash.update(&inner, 1);
+	hash.update(left, sha256::size);
+	hash.update(right, sha256::size);
+	hash.final(out);
+}
+
+// Works out every node above the leaves.
+
+void rawcont::grow(void)
+{
+	for (size_t l = 1; l + 1 < levels.size(); ++l) {
+		uint64 below = levels[l - 1];
+		uint64 count = levels[l] - below;
+
+		for (uint64 j = 0; 2 * j < count; ++j) {
+			byte* out = &tree[(levels[l] + j) * sha256::size];
+			const byte* left = &tree[(below + 2 * j) * sha256::size];
+
+			if (2 * j + 1 < count) tree_node(left, left + sha256::size, out);
+			else memcpy(out, left, sha256::size);
+		}
+	}
+}
+
+// The root tag is the SHA-256 of a secret derived from the key, the whole
+// container header and the root, so only the holder of the key can make a
+// tree that checks out, and the header cannot be changed under it.
+
+static void tree_tag(const byte secret[], const byte head[], const byte root[], byte out[])
+{
+	byte	outer = 2;
+	sha256	hash;
+
+	hash.update(&outer, 1);
+	hash.update(secret, rawfile::block);
+	hash.update(head, rawcont::header);
+	hash.update(root, sha256::size);
+	hash.final(out);
+}
+
+void rawcont::root_tag(byte out[]) const
+{
+	byte	root[sha256::size];
+
+	if (tree.empty()) {
+		sha256 hash;
+		hash.final(root);
+	}
+	else memcpy(root, &tree[tree.size() - sha256::size], sha256::size);
+
+	tree_tag(root_key, front, root, out);
+}
+
+static void tree_leaf(const byte head[], const byte buf[], const size_t len, byte out[])
+{
+	byte	outer = 0;
+	sha256	hash;
+
+	hash.update(&outer, 1);
+	hash.update(head, rawcont::chunk_header);
+	hash.update(buf, len);
+	hash.final(out);
+}
+
+// Climbs from a leaf for chunk i to the root, using only the nodes beside
+// the path, and checks the root against the tag.
+
+bool rawcont::check_path(const uint64 i, const byte leaf[]) const
+{
+	byte	node[sha256::size];
+	byte	top[sha256::size];
+	uint64	pos = i - first;
+
+	memcpy(node, leaf, sha256::size);
+
+	for (size_t l = 0; l + 2 < levels.size(); ++l, pos /= 2) {
+		uint64 count = levels[l + 1] - levels[l];
+		uint64 other = pos ^ 1;
+
+		if (other >= count) continue;
+
+		const byte* beside = &tree[(levels[l] + other) * sha256::size];
+
+		if (pos & 1) tree_node(beside, node, node);
+		else tree_node(node, beside, node);
+	}
+
+	tree_tag(root_key, front, node, top);
+
+	return memcmp(top, tag, sizeof(top)) == 0;
+}
+
+// After chunk i has been rewritten in place, works its leaf out again and
+// rewrites just the nodes on its path and the root tag.
+
+void rawcont::mend(rawfile& file, const uint64 i)
+{
+	const chunk_info& c = index[i - first];
+	byte head[chunk_header];
+	std::vector<byte> data(c.stored + 1);
+
+	if (file.read_at(head, chunk_header, &data[0], c.stored, c.offset) != chunk_header + c.stored)
+		throw "Cannot Read Input File!";
+
+	uint64 pos = i - first;
+	uint64 at = levels[0] + pos;
+
+	tree_leaf(head, &data[0], c.stored, &tree[at * sha256::size]);
+	file.write_at(&tree[at * sha256::size], sha256::size, tree_at + sha256::size * (1 + at));
+
+	for (size_t l = 1; l + 1 < levels.size(); ++l) {
+		uint64 count = levels[l] - levels[l - 1];
+		uint64 first = levels[l - 1] + (pos & ~static_cast<uint64>(1));
+
+		pos /= 2;
+		at = levels[l] + pos;
+
+		const byte* left = &tree[first * sha256::size];
+		if ((pos * 2 + 1) < count) tree_node(left, left + sha256::size, &tree[at * sha256::size]);
+		else memcpy(&tree[at * sha256::size], left, sha256::size);
+
+		file.write_at(&tree[at * sha256::size], sha256::size, tree_at + sha256::size * (1 + at));
+	}
+
+	root_tag(tag);
+	file.write_at(tag, sha256::size, tree_at);
+}
+
+// A partial container is only opened as one of the parts of a merge.
+
+void rawcont::open(rawfile& in, const bool part)
+{
+	byte	head[header];
+	byte	tail[trailer];
+	byte	zero[rawfile::block];
+	byte	check[rawfile::block];
+
+	if (!detect(in)
+		|| in.read_at(head, header, 0) != header
+		|| in.read_at(tail, trailer, in.size() - trailer) != trailer) throw "Not a rawaes Container!";
+
+	if (uint32_in(head + 8) != version) throw "Unsupported Container Version!";
+	if (static_cast<int>(uint32_in(head + 16)) != key_bits) throw "Container Uses a Different Key Size!";
+
+	memset(zero, 0, sizeof(zero));
+	crypto.encrypt(zero, check);
+	if (memcmp(check, head + 56, sizeof(check)) != 0) throw "Wrong Key for Container!";
+
+	crypto.encrypt(reinterpret_cast<const byte*>(rawcont_root), root_key);
+
+	uint32 m = uint32_in(head + 12);
+	if (m != ecb && m != ctr) throw "Unsupported Container Mode!";
+
+	mode = static_cast<rawcont_mode>(m);
+	flags = uint32_in(head + 20);
+	csize = uint32_in(head + 24);
+	olen = uint64_in(head + 32);
+	memcpy(nonce, head + 40, sizeof(nonce));
+	rounds = uint64_in(head + 80);
+	memcpy(front, head, sizeof(front));
+
+	// every container is made with a tree, and only the tree covers the header
+	if (!(flags & hashed)) throw "Container Is Damaged!";
+	if (csize == 0 || csize % rawfile::block != 0 || csize > chunk_size) throw "Container Is Damaged!";
+	if ((flags & partial) && !part) throw "Container Holds Only Part of a File, Merge It First!";
+
+	uint64 at = uint64_in(tail + 8);
+	uint64 n = uint64_in(tail + 16);
+	uint64 room = in.size() - trailer;
+
+	first = uint64_in(head + 72);
+
+	if (uint64_in(tail + 24) != olen || uint64_in(tail + 40) != first
+		|| first > total() || n > total() - first
+		|| (!(flags & partial) && (first != 0 || n != total()))
+		|| at > room || n > (room - at) / entry) throw "Container Is Damaged!";
+
+	held = first + n;
+
+	std::vector<byte> list(n * entry + 1);
+	if (in.read_at(&list[0], n * entry, at) != n * entry) throw "Container Is Damaged!";
+
+	index.assign(n, chunk_info());
+	for (uint64 k = 0; k < n; ++k) {
+		const byte* e = &list[k * entry];
+		chunk_info& c = index[k];
+		uint64 i = first + k;
+
+		c.offset = uint64_in(e);
+		c.plain = uint32_in(e + 8);
+		c.stored = uint32_in(e + 12);
+		c.flags = uint32_in(e + 16);
+		c.squeezed = uint32_in(e + 20);
+		c.round = uint64_in(e + 24);
+
+		if (c.round > rounds) rounds = c.round;
+
+		uint64 want = (i + 1 < total()) ? csize : olen - i * csize;
+		if (c.flags & hole) {
+			if (c.plain != want || c.offset != 0 || c.stored != 0 || c.squeezed != 0)
+				throw "Container Is Damaged!";
+			continue;
+		}
+
+		if (c.plain != want || c.stored > csize || c.offset < header || c.offset > at
+			|| chunk_header + c.stored > at - c.offset) throw "Container Is Damaged!";
+
+		if ((c.flags & packed) ? c.squeezed == 0 || c.squeezed >= want
+			|| c.stored != ((mode == ctr) ? c.squeezed : rawstream::padded(c.squeezed))
+			: c.squeezed != 0) throw "Container Is Damaged!";
+	}
+
+	tree_at = at + n * entry;
+	plant(n);
+
+	if (uint64_in(tail + 32) != tree_at || room - tree_at != sha256::size + tree.size()
+		|| in.read_at(tag, sha256::size, tree_at) != sha256::size
+		|| (!tree.empty() && in.read_at(&tree[0], tree.size(), tree_at + sha256::size) != tree.size()))
+		throw "Container Is Damaged!";
+
+	// the header and the root are checked here, each chunk's path as it is read
+	byte want[sha256::size];
+
+	root_tag(want);
+	if (memcmp(want, tag, sizeof(want)) != 0) throw "Container Is Damaged!";
+}
+
+// Decrypts len bytes of plaintext from pos onwards, reading only the chunks
+// that cover them, into the start of out.  The range is cut short at the
+// end of the original file.
+
+void rawcont::extract(rawfile& in, rawfile& out, rawpool& workers, const uint64 pos,
+	const uint64 len)
+{
+	from = (pos < olen) ? pos : olen;
+	to = (len < olen - from) ? from + len : olen;
+
+	bool sparse = false;
+	for (uint64 i = 0; i < index.size() && !sparse; ++i) sparse = (index[i].flags & hole) != 0;
+
+	if (!sparse) out.preallocate(to - from);
+
+	if (to > from) run(in, out, false, from / csize, (to - 1) / csize + 1, workers);
+
+	out.truncate(to - from);
+}
+
+// Chunks are handed out from a shared counter rather than queued up front,
+// so even a container of millions of chunks needs only one task per worker.
+
+void rawcont::run(rawfile& in, rawfile& out, const bool seal, const uint64 start,
+	const uint64 end, rawpool& workers)
+{
+	src = &in;
+	dst = &out;
+	sealing = seal;
+	claimed = start;
+	last = end;
+	error = NULL;
+
+	for (size_t i = 0; i < workers.size(); ++i) workers.push(new rawcont_worker(*this));
+	workers.wait();
+
+	src = NULL;
+	dst = NULL;
+
+	if (error != NULL) throw error;
+}
+
+void rawcont::work(rawworker& w)
+{
+	byte* buf = w.pool->buffers().get();
+	byte* spare = (flags & compressed) ? w.pool->buffers().get() : NULL;
+
+	// each worker needs its own copy of the new key schedule as well
+	aes fresh;
+	if (renew != NULL) fresh = *renew;
+
+	while (error == NULL) {
+		uint64 i = __sync_fetch_and_add(&claimed, 1);
+		if (i >= last) break;
+
+		try {
+			if (renew != NULL) {
+				size_t plain = read_chunk(w.crypto, *src, i, buf, spare);
+
+				if (index[i - first].flags & hole) hollow(i);
+				else store(fresh, i, buf, spare, plain);
+			}
+			else if (sealing) {
+				seal(w.crypto, i, buf, spare);
+				if (ckpt != NULL) finish(i);
+			}
+			else unseal(w.crypto, i, buf, spare);
+		} catch (const char* str) {
+			__sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), str);
+		}
+	}
+
+	w.pool->buffers().put(buf);
+	if (spare != NULL) w.pool->buffers().put(spare);
+}
+
+void rawcont::seal(aes& schedule, const uint64 i, byte buf[], byte spare[])
+{
+	uint32 plain = (i + 1 < total()) ? csize : olen - i * csize;
+
+	// a chunk wholly in a hole of the input need not be read at all
+	bool empty = holes && src->data_from(i * csize) >= static_cast<off_t>(i * csize + plain);
+
+	if (empty) memset(buf, 0, plain);
+	else if (src->read_at(buf, plain, i * csize) != plain) throw "Input File Changed Size!";
+
+	if (summing) {
+		byte* sum = &sums[i * sha256::size];
+		fingerprint(schedule, buf, plain, sum);
+
+		if ((i + 1) * sha256::size <= prior.size() && index[i - first].plain == plain
+			&& memcmp(sum, &prior[i * sha256::size], sha256::size) == 0) {
+			__sync_fetch_and_add(&reused, 1);
+			return;
+		}
+	}
+
+	if (empty) hollow(i);
+	else store(schedule, i, buf, spare, plain);
+}
+
+static void chunk_head(byte head[], const uint64 i, const rawcont::chunk_info& c)
+{
+	memset(head, 0, rawcont::chunk_header);
+	uint64_out(head, i);
+	uint32_out(head + 8, c.plain);
+	uint32_out(head + 12, c.stored);
+	uint32_out(head + 16, c.flags);
+	uint32_out(head + 20, c.squeezed);
+	uint64_out(head + 24, c.round);
+}
+
+// Notes chunk i as a hole, which is all there is to do for it.
+
+void rawcont::hollow(const uint64 i)
+{
+	chunk_info& c = index[i - first];
+	byte head[chunk_header];
+
+	c.offset = 0;
+	c.plain = (i + 1 < total()) ? csize : olen - i * csize;
+	c.stored = 0;
+	c.flags = hole;
+	c.squeezed = 0;
+	c.round = rounds;
+
+	chunk_head(head, i, c);
+	tree_leaf(head, head, 0, &(*leaves)[(levels[0] + i - first) * sha256::size]);
+}
+
+// Encrypts the plain bytes of chunk i in buf and writes them in its place,
+// noting its leaf of the tree.  In a compressed container the chunk is
+// compressed into spare first; the same plaintext always compresses the
+// same way, so a chunk that is rekeyed fits back where it was.
+
+void rawcont::store(aes& schedule, const uint64 i, byte buf[], byte spare[], const uint32 plain)
+{
+	rawstream stream(schedule, true);
+	byte* data = buf;
+	uint32 squeezed = 0;
+
+	if (flags & compressed) {
+		squeezed = rawlz::compress(buf, plain, spare, (plain > rawfile::block) ? plain - rawfile::block : 0);
+		if (squeezed != 0) data = spare;
+	}
+
+	uint32 len = (squeezed != 0) ? squeezed : plain;
+	uint32 stored = len;
+
+	if (mode == ctr) {
+		byte mine[rawfile::block];
+		chunk_nonce(nonce, rounds, mine);
+		stream.ctr(mine, i * csize / rawfile::block, data, len);
+	}
+	else {
+		stored = rawstream::padded(len);
+		memset(data + len, 0, stored - len);
+		stream.crypt(data, stored);
+	}
+
+	chunk_info& c = index[i - first];
+
+	if (!(flags & compressed)) c.offset = place(i);
+	else if (renew == NULL)
+		c.offset = __sync_fetch_and_add(&tail, static_cast<uint64>(chunk_header + stored));
+
+	c.plain = plain;
+	c.stored = stored;
+	c.flags = (squeezed != 0) ? packed : 0;
+	c.squeezed = squeezed;
+	c.round = rounds;
+
+	byte head[chunk_header];
+	chunk_head(head, i, c);
+
+	dst->write_at(head, chunk_header, data, stored, c.offset);
+	tree_leaf(head, data, stored, &(*leaves)[(levels[0] + i - first) * sha256::size]);
+}
+
+// Reads chunk i as stored into data, with its chunk header into head, and
+// checks both against the index and the tree, leaving the chunk's leaf in
+// leaf.  A hole chunk has nothing to read.
+
+void rawcont::fetch(rawfile& in, const uint64 i, byte head[], byte data[], byte leaf[]) const
+{
+	const chunk_info& c = index[i - first];
+
+	if (c.flags & hole) {
+		chunk_head(head, i, c);
+		tree_leaf(head, head, 0, leaf);
+	}
+	else {
+		if (in.read_at(head, chunk_header, data, c.stored, c.offset) != chunk_header + c.stored
+			|| uint64_in(head) != i || uint32_in(head + 8) != c.plain
+			|| uint32_in(head + 12) != c.stored || uint32_in(head + 16) != c.flags
+			|| uint32_in(head + 20) != c.squeezed || uint64_in(head + 24) != c.round)
+			throw "Container Chunk Is Damaged!";
+
+		tree_leaf(head, data, c.stored, leaf);
+	}
+
+	if (!check_path(i, leaf)) throw "Container Chunk Is Damaged!";
+}
+
+// Reads chunk i into buf and decrypts it.  Returns the number of plaintext
+// bytes.  A compressed chunk is read into spare and expanded into buf;
+// without a spare buffer one is made for it.
+
+size_t rawcont::read_chunk(aes& schedule, rawfile& in, const uint64 i, byte buf[],
+	byte spare[]) const
+{
+	const chunk_info& c = index[i - first];
+	byte head[chunk_header];
+	byte leaf[sha256::size];
+	std::vector<byte> room;
+
+	if ((c.flags & packed) && spare == NULL) {
+		room.resize(c.stored);
+		spare = &room[0];
+	}
+
+	byte* data = (c.flags & packed) ? spare : buf;
+
+	fetch(in, i, head, data, leaf);
+
+	if (c.flags & hole) {
+		memset(buf, 0, c.plain);
+		return c.plain;
+	}
+
+	rawstream stream(schedule, false);
+
+	if (mode == ctr) {
+		byte mine[rawfile::block];
+		chunk_nonce(nonce, c.round, mine);
+		stream.ctr(mine, i * csize / rawfile::block, data, c.stored);
+	}
+	else stream.crypt(data, c.stored);
+
+	if ((c.flags & packed) && !rawlz::expand(data, c.squeezed, buf, c.plain))
+		throw "Container Chunk Is Damaged!";
+
+	return c.plain;
+}
+
+void rawcont::unseal(aes& schedule, const uint64 i, byte buf[], byte spare[])
+{
+	uint64 start = i * csize;
+	uint64 end = start + read_chunk(schedule, *src, i, buf, spare);
+
+	uint64 lo = (start > from) ? start : from;
+	uint64 hi = (end < to) ? end : to;
+
+	// a hole goes back as a hole, or as zeros where that is not possible
+	if ((index[i - first].flags & hole) && dst->punch(lo - from, hi - lo)) return;
+
+	dst->write_at(buf + (lo - start), hi - lo, lo - from);
+}
+
+// Overwrites len bytes of plaintext at pos with buf, in place.  In ECB mode
+// only the blocks they fall in are encrypted again.  In CTR mode the new
+// bytes cannot go under the counters of the old ones, so every chunk they
+// touch is encrypted again whole, in a new round that is on disk before
+// any of them.  The chunk lengths stay as they are, so the range must lie
+// within the original file.
+
+void rawcont::update(aes& schedule, rawfile& file, const byte buf[], const size_t len,
+	const uint64 pos)
+{
+	if (pos > olen || len > olen - pos) throw "Update Runs Past the End of the File!";
+	if (flags & compressed) throw "Cannot Update a Compressed Container in Place!";
+
+	for (uint64 i = pos / csize; len != 0 && i <= (pos + len - 1) / csize; ++i)
+		if (index[i - first].flags & hole) throw "Cannot Update a Hole in a Sparse Container!";
+
+	if (mode == ctr && len != 0) {
+		// the tag covers the header, so it is made again over the new round
+		uint64_out(front + 80, ++rounds);
+		root_tag(tag);
+
+		file.write_at(front + 80, 8, 80);
+		file.write_at(tag, sha256::size, tree_at);
+		file.datasync();
+	}
+
+	size_t done = 0;
+
+	while (done < len) {
+		uint64	at = pos + done;
+		uint64	i = at / csize;
+		size_t	off = at - i * csize;
+		size_t	part = (csize - off < len - done) ? csize - off : len - done;
+
+		patch(schedule, file, i, off, buf + done, part);
+		mend(file, i);
+
+		done += part;
+	}
+}
+
+void rawcont::patch(aes& schedule, rawfile& file, const uint64 i, const size_t off,
+	const byte buf[], const size_t len)
+{
+	uint64		data = index[i - first].offset + chunk_header;
+	rawstream	stream(schedule, true);
+
+	if (mode == ecb) {
+		stream.patch(file, buf, len, data + off);
+		return;
+	}
+
+	chunk_info&			c = index[i - first];
+	std::vector<byte>	text(csize);
+	byte				mine[rawfile::block];
+	byte				head[chunk_header];
+	byte				r[8];
+
+	read_chunk(schedule, file, i, &text[0]);
+	memcpy(&text[off], buf, len);
+
+	c.round = rounds;
+	chunk_nonce(nonce, rounds, mine);
+	stream.ctr(mine, i * csize / rawfile::block, &text[0], c.plain);
+
+	chunk_head(head, i, c);
+	file.write_at(head, chunk_header, &text[0], c.plain, c.offset);
+
+	// and the round in its index entry
+	uint64_out(r, rounds);
+	file.write_at(r, sizeof(r), tree_at - index.size() * entry + (i - first) * entry + 24);
+}
+
+// A fingerprint is the SHA-256 of a secret derived from the key followed by
+// the chunk's plaintext, so the sums file says nothing about the plaintext
+// to anyone without the key, beyond which chunks are alike.
+
+void rawcont::fingerprint(aes& schedule, const byte buf[], const size_t len, byte sum[]) const
+{
+	byte	secret[rawfile::block];
+	sha256	hash;
+
+	schedule.encrypt(reinterpret_cast<const byte*>(rawcont_label), secret);
+
+	hash.update(secret, sizeof(secret));
+	hash.update(buf, len);
+	hash.final(sum);
+}
+
+// The sums file, kept next to the container, holds the fingerprint of each
+// chunk as it was last written:
+//
+//   header    48 bytes:  "rawaesS1", version (4), digest size (4),
+//                        chunk size (4), mode (4), chunk count (8),
+//                        original length (8), reserved (8)
+//   sums      digest size bytes per chunk
+//
+// read_sums() takes them up only if they describe the container as it was
+// opened; otherwise every chunk counts as changed.
+
+bool rawcont::read_sums(const char* path)
+{
+	rawfile	f;
+	byte	head[sums_header];
+
+	prior.clear();
+
+	if (f.open(path, rawfile::in) != B_OK || f.read_at(head, sums_header, 0) != sums_header) return false;
+
+	uint64 n = uint64_in(head + 24);
+
+	if (memcmp(head, rawcont_sums, 8) != 0 || uint32_in(head + 8) != version
+		|| uint32_in(head + 12) != sha256::size || uint32_in(head + 16) != csize
+		|| uint32_in(head + 20) != static_cast<uint32>(mode) || n != index.size()
+		|| uint64_in(head + 32) != olen
+		|| static_cast<uint64>(f.size()) != sums_header + n * sha256::size) return false;
+
+	std::vector<byte> list(n * sha256::size);
+	if (n != 0 && f.read_at(&list[0], list.size(), sums_header) != list.size()) return false;
+
+	prior.swap(list);
+	return true;
+}
+
+// Written to a new file that then replaces the old, so the sums on disk are
+// always whole.
+
+void rawcont::write_sums(const char* path) const
+{
+	std::string	temp = std::string(path) + ".new";
+	rawfile		f;
+	byte		head[sums_header];
+
+	memset(head, 0, sizeof(head));
+	memcpy(head, rawcont_sums, 8);
+	uint32_out(head + 8, version);
+	uint32_out(head + 12, sha256::size);
+	uint32_out(head + 16, csize);
+	uint32_out(head + 20, mode);
+	uint64_out(head + 24, index.size());
+	uint64_out(head + 32, olen);
+
+	unlink(temp.c_str());
+	if (f.open(temp.c_str(), rawfile::out) != B_OK) throw "Cannot Write Chunk Sums!";
+
+	f.write_at(head, sums_header, 0);
+	if (!sums.empty()) f.write_at(&sums[0], sums.size(), sums_header);
+	f.unset();
+
+	if (rename(temp.c_str(), path) != 0) throw "Cannot Write Chunk Sums!";
+}
+
+// Moves every chunk from the key the container was opened with to fresh,
+// writing the result to out, which may be the file it was opened from:
+// every chunk is decrypted, checked and encrypted again in memory and
+// goes back to the same place.  The header, the tree and its root tag are
+// then made under fresh.  A rewrite in place that is cut short leaves the
+// container unreadable under either key, so rawaes writes a new copy and
+// renames it over the old instead.
+
+void rawcont::rekey(rawfile& in, rawfile& out, aes& fresh, rawpool& workers)
+{
+	uint64 n = index.size();
+
+	// chunks are checked against the old tree while the new one is made
+	std::vector<byte> renewed(tree.size());
+	leaves = &renewed;
+	renew = &fresh;
+
+	try {
+		run(in, out, true, 0, n, workers);
+	} catch (...) {
+		leaves = &tree;
+		renew = NULL;
+		throw;
+	}
+
+	leaves = &tree;
+	renew = NULL;
+
+	layout(out, fresh);
+	if (n != 0) memcpy(&tree[0], &renewed[0], n * sha256::size);
+
+	write_index(out);
+}
+
+
+// Makes the whole container in out from the partial containers in parts,
+// which between them must hold every chunk of one file exactly once.  Each
+// chunk is copied as it is stored, checked against the tree of its part
+// on the way; only the header, the index and the tree are made anew.
+
+void rawcont::merge(const std::vector<rawfile*>& parts, rawfile& out)
+{
+	std::vector<rawcont*>	pieces;
+	std::vector<std::pair<uint64, size_t> >	order;	// first chunk and part
+
+	try {
+		for (size_t p = 0; p < parts.size(); ++p) {
+			pieces.push_back(new rawcont(crypto, key_bits));
+			pieces[p]->open(*parts[p], true);
+			order.push_back(std::make_pair(pieces[p]->first, p));
+		}
+
+		if (pieces.empty()) throw "No Parts to Merge!";
+		std::sort(order.begin(), order.end());
+
+		const rawcont& a = *pieces[order[0].second];
+
+		mode = a.mode;
+		flags = hashed | (a.flags & compressed);
+		csize = a.csize;
+		olen = a.olen;
+		memcpy(nonce, a.nonce, sizeof(nonce));
+		rounds = 0;
+		first = 0;
+		held = total();
+		holes = false;
+
+		uint64 next = 0;
+
+		for (size_t p = 0; p < order.size(); ++p) {
+			const rawcont& c = *pieces[order[p].second];
+
+			if (c.mode != mode || c.csize != csize || c.olen != olen
+				|| memcmp(c.nonce, nonce, sizeof(nonce)) != 0
+				|| (c.flags & compressed) != (flags & compressed)) throw "Parts Are Not of One File!";
+			if (c.first != next) throw "Parts Do Not Cover the File Exactly Once!";
+
+			for (uint64 k = 0; k < c.index.size(); ++k) if (c.index[k].flags & hole) holes = true;
+			if (c.rounds > rounds) rounds = c.rounds;
+			next = c.held;
+		}
+
+		if (next != held) throw "Parts Do Not Cover the File Exactly Once!";
+
+		index.assign(held, chunk_info());
+		layout(out);
+
+		std::vector<byte>	data(csize + 1);
+		byte				head[chunk_header];
+
+		for (size_t p = 0; p < order.size(); ++p) {
+			const rawcont&	c = *pieces[order[p].second];
+			rawfile&		in = *parts[order[p].second];
+
+			for (uint64 i = c.first; i < c.held; ++i) {
+				chunk_info& d = index[i];
+
+				d = c.index[i - c.first];
+				c.fetch(in, i, head, &data[0], &tree[(levels[0] + i) * sha256::size]);
+
+				if (d.flags & hole) continue;
+
+				d.offset = (flags & compressed) ? tail : place(i);
+				tail += chunk_header + d.stored;
+
+				out.write_at(head, chunk_header, &data[0], d.stored, d.offset);
+			}
+		}
+
+		write_index(out);
+	} catch (...) {
+		for (size_t p = 0; p < pieces.size(); ++p) delete pieces[p];
+		throw;
+	}
+
+	for (size_t p = 0; p < pieces.size(); ++p) delete pieces[p];
+}
+
+// Makes create() keep a checkpoint at path, saved every so many seconds,
+// or carry on from the one there if resume is set and it matches.  The
+// input's modification and change times, length and inode tell one
+// version of it from another; a rewrite that keeps the modification time
+// still changes the change time, and a copy put in its place the inode.
+
+void rawcont::checkpoint(const char* path, const struct stat& input, const int every,
+	const bool resume)
+{
+	ckpt_path = path;
+	ckpt_stamp[0] = static_cast<uint64>(input.st_mtim.tv_sec) * 1000000000 + input.st_mtim.tv_nsec;
+	ckpt_stamp[1] = static_cast<uint64>(input.st_ctim.tv_sec) * 1000000000 + input.st_ctim.tv_nsec;
+	ckpt_stamp[2] = input.st_size;
+	ckpt_stamp[3] = input.st_ino;
+	ckpt_every = every;
+	resuming = resume;
+}
+
+void rawcont::ckpt_head(byte head[]) const
+{
+	byte zero[rawfile::block];
+
+	memset(zero, 0, sizeof(zero));
+	memset(head, 0, ckpt_header);
+	memcpy(head, rawcont_ckpt, 8);
+	uint32_out(head + 8, version);
+	uint32_out(head + 12, mode);
+	uint32_out(head + 16, key_bits);
+	uint32_out(head + 20, flags);
+	uint32_out(head + 24, csize);
+	uint64_out(head + 32, olen);
+	memcpy(head + 40, nonce, sizeof(nonce));
+	crypto.encrypt(zero, head + 56);
+	uint64_out(head + 72, first);
+	uint64_out(head + 80, held);
+	for (int k = 0; k < 4; ++k) uint64_out(head + 88 + 8 * k, ckpt_stamp[k]);
+}
+
+// Opens the checkpoint to resume from, taking up its nonce, or starts a new
+// one if there is none.  One made for another input, key or setting is an
+// error rather than something to quietly start over from.
+
+void rawcont::start_ckpt(void)
+{
+	byte head[ckpt_header];
+
+	ckpt = new rawfile;
+	finished.assign(index.size(), 0);
+	counted = 0;
+	reach = header;
+	generation = 0;
+	saved = time(NULL);
+
+	if (resuming && ckpt->open(ckpt_path.c_str(), rawfile::update) == B_OK) {
+		byte was[ckpt_header];
+
+		if (ckpt->read_at(was, ckpt_header, 0) != ckpt_header) throw "Checkpoint Is Damaged!";
+		if (mode == ctr && !fixed) memcpy(nonce, was + 40, sizeof(nonce));
+
+		ckpt_head(head);
+		if (memcmp(head, was, ckpt_header) != 0)
+			throw "Checkpoint Is for Another Input, Key or Setting!";
+	}
+	else {
+		byte slots[2 * ckpt_slot];
+
+		resuming = false;
+		if (ckpt->open(ckpt_path.c_str(), rawfile::out) != B_OK) throw "Cannot Write Checkpoint!";
+
+		ckpt_head(head);
+		memset(slots, 0, sizeof(slots));
+
+		ckpt->truncate(0);
+		ckpt->write_at(head, ckpt_header, 0);
+		ckpt->write_at(slots, sizeof(slots), ckpt_header);
+
+		// saves sync the file, but its name must be on disk too
+		ckpt->datasync();
+		rawfile::sync_dir(ckpt_path.c_str());
+	}
+
+	ckpt_top.assign(head, head + ckpt_header);
+}
+
+static void slot_sum(const std::vector<byte>& top, const byte slot[], byte out[])
+{
+	sha256 hash;
+
+	hash.update(&top[0], top.size());
+	hash.update(slot, 32);
+	hash.final(out);
+}
+
+// Takes up every chunk the latest whole save counts as done, checking its
+// record against the layout and the last of them against the output.
+
+void rawcont::load_ckpt(rawfile& out)
+{
+	byte	slot[ckpt_slot];
+	byte	sum[sha256::size];
+	uint64	upto = 0;
+	uint64	end = header;
+
+	for (int k = 0; k < 2; ++k) {
+		if (ckpt->read_at(slot, ckpt_slot, ckpt_header + k * ckpt_slot) != ckpt_slot)
+			throw "Checkpoint Is Damaged!";
+
+		slot_sum(ckpt_top, slot, sum);
+		if (memcmp(sum, slot + 32, sizeof(sum)) != 0 || uint64_in(slot) <= generation) continue;
+
+		generation = uint64_in(slot);
+		upto = uint64_in(slot + 8);
+		end = uint64_in(slot + 16);
+	}
+
+	if (upto > index.size()) throw "Checkpoint Is Damaged!";
+	if (upto == 0) return;
+
+	std::vector<byte> list(upto * ckpt_record);
+	if (ckpt->read_at(&list[0], list.size(), ckpt_header + 2 * ckpt_slot) != list.size())
+		throw "Checkpoint Is Damaged!";
+
+	uint64 last = upto;
+
+	for (uint64 k = 0; k < upto; ++k) {
+		const byte* rec = &list[k * ckpt_record];
+		chunk_info& c = index[k];
+		uint64 i = first + k;
+		uint64 want = (i + 1 < total()) ? csize : olen - i * csize;
+
+		c.offset = uint64_in(rec);
+		c.plain = uint32_in(rec + 8);
+		c.stored = uint32_in(rec + 12);
+		c.flags = uint32_in(rec + 16);
+		c.squeezed = uint32_in(rec + 20);
+		c.round = uint64_in(rec + 24);
+
+		bool bad = (c.plain != want || c.round != rounds);
+
+		if (c.flags & hole) bad = bad || c.offset != 0 || c.stored != 0 || c.squeezed != 0;
+		else {
+			bad = bad || c.stored > csize || c.offset < header || c.offset + chunk_header + c.stored > end
+				|| (!(flags & compressed) && c.offset != place(i))
+				|| ((c.flags & packed) ? c.squeezed == 0 || c.squeezed >= want
+					|| c.stored != ((mode == ctr) ? c.squeezed : rawstream::padded(c.squeezed))
+					: c.squeezed != 0);
+			last = k;
+		}
+
+		if (bad) throw "Checkpoint Is Damaged!";
+
+		memcpy(&tree[(levels[0] + k) * sha256::size], rec + 32, sha256::size);
+		finished[k] = 1;
+	}
+
+	// the output must still hold what the checkpoint says; the last chunk
+	// saved stands for the others
+	if (last < upto) {
+		const chunk_info& c = index[last];
+		byte head[chunk_header];
+		byte leaf[sha256::size];
+		std::vector<byte> data(c.stored + 1);
+
+		if (out.read_at(head, chunk_header, &data[0], c.stored, c.offset) != chunk_header + c.stored)
+			throw "Output File Does Not Match the Checkpoint!";
+
+		tree_leaf(head, &data[0], c.stored, leaf);
+		if (memcmp(leaf, &tree[(levels[0] + last) * sha256::size], sizeof(leaf)) != 0)
+			throw "Output File Does Not Match the Checkpoint!";
+	}
+
+	// chunks stored below end but not counted are made again after it,
+	// leaving their old space unused
+	done = counted = skipped = upto;
+	reach = tail = end;
+}
+
+// Notes chunk i as finished in its record, and makes a save if one is due.
+// Whichever worker takes the save lock checks whether one is due, reading
+// saved only under the lock; the others carry on.
+
+void rawcont::finish(const uint64 i)
+{
+	uint64	k = i - first;
+	const chunk_info& c = index[k];
+	byte	rec[ckpt_record];
+
+	memset(rec, 0, sizeof(rec));
+	uint64_out(rec, c.offset);
+	uint32_out(rec + 8, c.plain);
+	uint32_out(rec + 12, c.stored);
+	uint32_out(rec + 16, c.flags);
+	uint32_out(rec + 20, c.squeezed);
+	uint64_out(rec + 24, c.round);
+	memcpy(rec + 32, &tree[(levels[0] + k) * sha256::size], sha256::size);
+
+	ckpt->write_at(rec, ckpt_record, ckpt_header + 2 * ckpt_slot + k * ckpt_record);
+
+	pthread_mutex_lock(&done_lock);
+	finished[k] = 1;
+	while (done < finished.size() && finished[done]) ++done;
+	pthread_mutex_unlock(&done_lock);
+
+	if (pthread_mutex_trylock(&save_lock) != 0) return;
+
+	try {
+		if (time(NULL) - saved >= ckpt_every) save(*dst);
+	} catch (...) {
+		pthread_mutex_unlock(&save_lock);
+		throw;
+	}
+
+	pthread_mutex_unlock(&save_lock);
+}
+
+void rawcont::save(rawfile& out)
+{
+	pthread_mutex_lock(&done_lock);
+	uint64 upto = done;
+	pthread_mutex_unlock(&done_lock);
+
+	// a compressed container goes on from the end of the chunks saved
+	for (; counted < upto; ++counted) {
+		const chunk_info& c = index[counted];
+
+		if (!(c.flags & hole) && c.offset + chunk_header + c.stored > reach)
+			reach = c.offset + chunk_header + c.stored;
+	}
+
+	out.datasync();
+	ckpt->datasync();
+
+	byte slot[ckpt_slot];
+
+	memset(slot, 0, sizeof(slot));
+	uint64_out(slot, generation + 1);
+	uint64_out(slot + 8, upto);
+	uint64_out(slot + 16, reach);
+	slot_sum(ckpt_top, slot, slot + 32);
+
+	ckpt->write_at(slot, ckpt_slot, ckpt_header + ((generation + 1) & 1) * ckpt_slot);
+	ckpt->datasync();
+
+	++generation;
+	saved = time(NULL);
+}
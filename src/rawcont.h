@@ -0,0 +1,284 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawcont.h                                     (file 8) |
+|********************************************************/
+
+#if !defined(rawcont_h)
+#define rawcont_h
+
+#include <ctime>
+#include <pthread.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawhash.h"
+#include "rawpool.h"
+#include <be/support/SupportDefs.h>
+
+// A container holds one file cut into chunks of a fixed size, each of
+// which is encrypted on its own.  Every number is little endian.
+//
+//   header    96 bytes:  "rawaesC1", version (4), mode (4), key bits (4),
+//                        flags (4), chunk size (4), reserved (4),
+//                        original length (8), nonce (16),
+//                        the encrypted zero block (16), first chunk (8),
+//                        round (8), reserved (8)
+//   chunks    a 32 byte chunk header: index (8), plain length (4),
+//             stored length (4), flags (4), compressed length (4),
+//             round (8); followed by the stored bytes
+//   index     32 bytes per chunk: offset of its chunk header (8), plain
+//             length (4), stored length (4), flags (4), compressed
+//             length (4), round (8)
+//   tree      the root tag (32), then every node of a hash tree over the
+//             chunks, leaves first
+//   trailer   64 bytes:  "rawaesF1", index offset (8), chunk count (8),
+//                        original length (8), tree offset (8),
+//                        first chunk (8), reserved (16)
+//
+// Each leaf of the tree is the SHA-256 of a chunk as stored, header and
+// all, and each node above the SHA-256 of its two children; a node left
+// without a partner is carried up as it is.  The root tag binds the root
+// and the whole header to the key, so a changed nonce, length or flag is
+// found when the container is opened.  The hashed flag must be set; a
+// container without a tree is refused.  Checking one chunk takes only the
+// nodes beside its path to the root, so readers check just the chunks
+// they read, and each worker checks its own chunks while extracting.
+//
+// Chunk i holds plaintext bytes i * chunk size onwards.  In ECB mode its
+// last block is padded; in CTR mode nothing is, and block n of the file is
+// encrypted with the counter nonce + n, so the original length comes back
+// exactly either way.
+//
+// Each chunk notes the round it was last encrypted in, and in CTR mode the
+// round is XORed into the random half of the nonce for that chunk.  A new
+// container is round 0; every later run that rewrites chunks in place
+// starts a round above any the container has seen and makes it durable
+// before writing, so a chunk encrypted again never uses a counter twice.
+//
+// In a compressed container a chunk is compressed before it is encrypted
+// and kept that way if that saves at least a block; its flags say so and
+// its compressed length is recorded.  Such chunks no longer have a fixed
+// place: each goes after the last one written, in whatever order the
+// workers finish them, and only the index says where.
+//
+// A chunk that lies wholly in a hole of a sparse input is a hole chunk:
+// its flags say so and nothing of it is stored, not even its chunk header,
+// so the index is the map of the holes.  Its leaf of the tree is made from
+// the chunk header it would have had.  Decrypting leaves a hole in its
+// place again.
+//
+// A partial container holds only the chunks from its first chunk onwards,
+// as many as its count says, numbered and encrypted just as in the whole
+// container, with a tree over those chunks alone.  In CTR mode the hosts
+// making them each derive the nonce from the key, the input's length and
+// modification time and a job name, so a changed input or a new job gets
+// a new nonce.  Partial containers made from the same input, key and
+// nonce are merged
+// into the whole container by copying their chunks, which are checked on
+// the way but not decrypted.
+//
+// A container may keep a sums file alongside, with a fingerprint of every
+// chunk's plaintext, so that re-encrypting a changed input rewrites only
+// the chunks that changed.
+//
+// While a container is made it may also keep a checkpoint file, so a run
+// that is cut short can be resumed from the last chunk it saved:
+//
+//   header    128 bytes: "rawaesP1", version (4), mode (4), key bits (4),
+//                        flags (4), chunk size (4), reserved (4),
+//                        original length (8), nonce (16), the encrypted
+//                        zero block (16), first chunk (8), end chunk (8),
+//                        input modification time (8), change time (8),
+//                        length (8) and inode (8), reserved (8)
+//   slots     two of 64 bytes: generation (8), chunks done (8), end of
+//             the chunks done (8), reserved (8), and the SHA-256 of the
+//             header and the slot up to here (32)
+//   records   64 bytes per chunk, written as each chunk is finished: its
+//             index entry (32), its leaf of the tree (32)
+//
+// Every chunk below the count in a slot is finished and on disk.  A save
+// syncs the output and the records first, then writes the slot the last
+// save did not use and syncs that, so one slot always holds a whole save.
+//
+// A compressed container resumes writing at the end of the chunks done.
+// Chunks finished out of order past the count may have been stored below
+// that end; they are made again, and the space they took stays in the
+// container unused, at most about one chunk per worker for each resume.
+// Nothing points into it, and a later run without --resume drops it.
+
+class rawcont
+{
+public:
+	enum rawcont_const	{	header = 96,
+							chunk_header = 32,
+							entry = 32,
+							trailer = 64,
+							sums_header = 48,
+							ckpt_header = 128,
+							ckpt_slot = 64,
+							ckpt_record = 64,
+							version = 3,
+							chunk_size = rawfile::buffer	// the default and the largest
+						};
+
+	enum rawcont_mode	{	ecb = 1,
+							ctr = 2
+						};
+
+	enum rawcont_flags	{	hashed = 1,		// the footer holds a hash tree
+							compressed = 2,	// chunks are compressed where it helps
+							partial = 4		// only a run of the file's chunks is held
+						};
+
+	enum rawcont_chunk_flags	{	packed = 1,	// the chunk is stored compressed
+									hole = 2	// the chunk is all hole, nothing is stored
+								};
+
+	struct chunk_info
+	{
+		uint64		offset;		// where the chunk header is
+		uint32		plain;		// plaintext bytes in the chunk
+		uint32		stored;		// bytes stored after the chunk header
+		uint32		flags;
+		uint32		squeezed;	// compressed bytes before padding, if packed
+		uint64		round;		// the round it was last encrypted in
+	};
+
+	rawcont(aes& c, const int bits);
+   ~rawcont(void);
+
+	static bool	detect(rawfile& in);
+
+	void		create(rawfile& in, rawfile& out, const rawcont_mode m, const uint32 chunk,
+					rawpool& workers);
+	void		open(rawfile& in, const bool part = false);
+	void		merge(const std::vector<rawfile*>& parts, rawfile& out);
+	void		refresh(rawfile& in, rawfile& out, rawpool& workers);
+	void		rekey(rawfile& in, rawfile& out, aes& fresh, rawpool& workers);
+	void		extract(rawfile& in, rawfile& out, rawpool& workers,
+					const uint64 pos = 0, const uint64 len = ~static_cast<uint64>(0));
+
+	void		keep_sums(const bool on)	{ summing = on; };
+	void		compress(const bool on)		{ packing = on; };
+	void		span(const uint64 start, const uint64 end);	// make a partial container
+	void		bind_nonce(const uint64 size, const uint64 stamp, const std::string& job);
+	void		checkpoint(const char* path, const struct stat& input, const int every,
+					const bool resume);
+	bool		read_sums(const char* path);
+	void		write_sums(const char* path) const;
+
+	size_t		read_chunk(aes& schedule, rawfile& in, const uint64 i, byte buf[],
+					byte spare[] = NULL) const;
+	void		update(aes& schedule, rawfile& file, const byte buf[], const size_t len,
+					const uint64 pos);
+	void		work(rawworker& w);
+
+	uint64		length(void) const	{ return olen; };
+	uint64		chunks(void) const	{ return index.size(); };
+	uint32		chunk(void) const	{ return csize; };
+	rawcont_mode	chunk_mode(void) const	{ return mode; };
+	uint64		unchanged(void) const	{ return reused; };
+	uint64		resumed(void) const	{ return skipped; };
+
+private:
+	aes&		crypto;
+	int			key_bits;
+
+	rawcont_mode	mode;
+	uint32		flags;
+	uint32		csize;
+	uint64		olen;
+	byte		nonce[rawfile::block];
+	uint64		rounds;		// the latest round any chunk was encrypted in
+
+	uint64		first;		// the first chunk held
+	uint64		held;		// one past the last chunk held
+	bool		spanning;	// true to make a partial container
+	bool		fixed;		// true if the nonce was derived rather than made
+	std::vector<chunk_info>	index;	// from the first chunk held onwards
+	std::vector<byte>		tree;	// every node, leaves first
+	std::vector<uint64>		levels;	// the first node of each level, then the node count
+	byte		front[header];		// the header as on disk, which the tag covers
+	byte		tag[sha256::size];	// binds the header and the root to the key
+	byte		root_key[rawfile::block];	// the secret the tag is made with
+	uint64		tree_at;	// where the tree is stored
+	std::vector<byte>*	leaves;	// where sealed chunks note their leaves
+	std::vector<byte>		sums;	// chunk fingerprints, filled in as chunks are sealed
+	std::vector<byte>		prior;	// fingerprints from the last run, if any
+	uint64		reused;		// chunks found unchanged and left alone
+	bool		summing;	// true to fingerprint chunks as they are sealed
+	bool		packing;	// true to make a new container compressed
+	bool		holes;		// true if the input has holes to keep
+
+	// checkpoints, while create() runs
+	std::string	ckpt_path;	// empty unless checkpointing
+	uint64		ckpt_stamp[4];	// identifies the input as it was
+	int			ckpt_every;	// seconds between saves
+	bool		resuming;	// true to carry on from the checkpoint
+	rawfile*	ckpt;
+	std::vector<byte>	ckpt_top;	// the header of the checkpoint file
+	std::vector<byte>	finished;	// one per chunk held, set once it is done
+	uint64		done;		// chunks from the first held, all finished
+	uint64		counted;	// chunks whose end is in reach
+	uint64		reach;		// the end of the furthest chunk counted
+	uint64		generation;	// saves made so far
+	uint64		skipped;	// chunks found done when resuming
+	time_t		saved;		// when the last save was made, under save_lock
+	pthread_mutex_t	done_lock;
+	pthread_mutex_t	save_lock;
+
+	// used while the workers run
+	rawfile*	src;
+	rawfile*	dst;
+	bool		sealing;	// true to encrypt chunks, false to decrypt them
+	aes*		renew;		// the new key while chunks are being rekeyed
+	uint64		claimed;	// the next chunk for a worker to take
+	uint64		last;		// one past the last chunk to process
+	uint64		tail;		// where the next compressed chunk goes
+	uint64		from;		// the plaintext range wanted when decrypting
+	uint64		to;
+	const char*	error;
+
+	void		run(rawfile& in, rawfile& out, const bool seal, const uint64 start,
+					const uint64 end, rawpool& workers);
+	uint64		total(void) const	{ return (olen + csize - 1) / csize; };
+	uint64		place(const uint64 i) const	{ return header + (i - first) * (chunk_header + csize); };
+	void		layout(rawfile& out);
+	void		layout(rawfile& out, aes& schedule);
+	void		write_index(rawfile& out);
+	void		plant(const uint64 n);
+	void		grow(void);
+	void		root_tag(byte out[]) const;
+	bool		check_path(const uint64 i, const byte leaf[]) const;
+	void		mend(rawfile& file, const uint64 i);
+	void		fingerprint(aes& schedule, const byte buf[], const size_t len, byte sum[]) const;
+	void		seal(aes& schedule, const uint64 i, byte buf[], byte spare[]);
+	void		store(aes& schedule, const uint64 i, byte buf[], byte spare[],
+					const uint32 plain);
+	void		hollow(const uint64 i);
+	void		fetch(rawfile& in, const uint64 i, byte head[], byte data[], byte leaf[]) const;
+	void		ckpt_head(byte head[]) const;
+	void		start_ckpt(void);
+	void		load_ckpt(rawfile& out);
+	void		finish(const uint64 i);
+	void		save(rawfile& out);
+	void		unseal(aes& schedule, const uint64 i, byte buf[], byte spare[]);
+	void		patch(aes& schedule, rawfile& file, const uint64 i, const size_t off,
+					const byte buf[], const size_t len);
+};
+
+#endif
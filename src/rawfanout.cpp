@@ -0,0 +1,92 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawfanout.cpp                                 (file 9) |
+|********************************************************/
+
+#include "rawfanout.h"
+#include "rawstream.h"
+
+#include <cstring>
+
+class rawfanout_worker : public rawtask
+{
+public:
+	rawfanout_worker(rawfanout& f) : fanout(f) {};
+	void	run(rawworker& w) { fanout.work(w); };
+
+private:
+	rawfanout&	fanout;
+};
+
+void rawfanout::add(const aes& schedule, rawfile& out)
+{
+	keys.push_back(schedule);
+	outs.push_back(&out);
+}
+
+void rawfanout::run(rawfile& in)
+{
+	off_t size = rawstream::padded(in.size());
+
+	src = &in;
+	count = (in.size() + rawfile::buffer - 1) / rawfile::buffer;
+	claimed = 0;
+	error = NULL;
+
+	for (size_t k = 0; k < outs.size(); ++k) outs[k]->preallocate(size);
+
+	for (size_t i = 0; i < pool.size(); ++i) pool.push(new rawfanout_worker(*this));
+	pool.wait();
+
+	if (error != NULL) throw error;
+
+	for (size_t k = 0; k < outs.size(); ++k) outs[k]->truncate(size);
+}
+
+void rawfanout::work(rawworker& w)
+{
+	rawbuffers&	buffers = w.pool->buffers();
+	byte*		plain = buffers.get();
+	byte*		buf = buffers.get();
+
+	// this worker's own copies of the schedules
+	std::vector<aes> mine(keys);
+
+	while (error == NULL) {
+		uint64 i = __sync_fetch_and_add(&claimed, 1);
+		if (i >= count) break;
+
+		off_t	pos = i * rawfile::buffer;
+		size_t	len = (src->size() - pos < rawfile::buffer)
+			? src->size() - pos : static_cast<off_t>(rawfile::buffer);
+		size_t	plen = rawstream::padded(len);
+
+		try {
+			if (src->read_at(plain, len, pos) != len) throw "Input File Changed Size!";
+			memset(plain + len, 0, plen - len);
+
+			for (size_t k = 0; k < mine.size(); ++k) {
+				rawstream stream(mine[k], true);
+
+				memcpy(buf, plain, plen);
+				stream.crypt(buf, plen);
+				outs[k]->write_at(buf, plen, pos);
+			}
+		} catch (const char* str) {
+			__sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), str);
+		}
+	}
+
+	buffers.put(buf);
+	buffers.put(plain);
+}
@@ -0,0 +1,58 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawfanout.h                                  (file 10) |
+|********************************************************/
+
+#if !defined(rawfanout_h)
+#define rawfanout_h
+
+#include <sys/types.h>
+#include <vector>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawpool.h"
+#include <be/support/SupportDefs.h>
+
+// rawfanout encrypts one input to several outputs, each under its own key,
+// reading the input only once.  Each worker takes rawfile::buffer bytes at
+// a time, reads them into one buffer and, for every output in turn,
+// encrypts a copy with that output's key and writes it, so the cipher work
+// for all the keys is spread over the workers piece by piece.  Every
+// output is a plain rawaes file, as if encrypted on its own.
+
+class rawfanout
+{
+public:
+	rawfanout(rawpool& workers) : pool(workers), src(NULL), count(0), claimed(0),
+		error(NULL) {};
+
+	void		add(const aes& schedule, rawfile& out);
+	void		run(rawfile& in);
+	void		work(rawworker& w);
+
+	size_t		size(void) const	{ return keys.size(); };
+
+private:
+	rawpool&	pool;
+
+	std::vector<aes>		keys;		// one expanded schedule per output
+	std::vector<rawfile*>	outs;
+
+	rawfile*	src;
+	uint64		count;		// pieces in the input
+	uint64		claimed;
+	const char*	error;
+};
+
+#endif
@@ -0,0 +1,526 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawfile.cpp                                  (file 11) |
+|********************************************************/
+
+#include "rawfile.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// The alignment direct I/O needs on fd, at least a page, or 0 if it needs
+// more than page aligned buffers of rawfile::buffer bytes can give.  The
+// kernel says where it can; otherwise the filesystem block is taken, which
+// is a multiple of what the device needs.
+
+static size_t direct_align(const int fd)
+{
+	size_t align = rawfile::page;
+
+#if defined(STATX_DIOALIGN)
+	struct statx sx;
+
+	if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &sx) == 0 && (sx.stx_mask & STATX_DIOALIGN)) {
+		if (sx.stx_dio_offset_align == 0 || sx.stx_dio_mem_align > rawfile::page) return 0;
+		if (sx.stx_dio_offset_align > align) align = sx.stx_dio_offset_align;
+	}
+	else
+#endif
+	{
+		struct statvfs vfs;
+		if (fstatvfs(fd, &vfs) == 0 && vfs.f_bsize > align) align = vfs.f_bsize;
+	}
+
+	// rounding must stay within a buffer, and keep to whole buffers
+	if (align > rawfile::buffer || (align & (align - 1)) != 0) return 0;
+
+	return align;
+}
+
+status_t rawfile::open(const char* path, const rawfile_mode m, const policy& p)
+{
+	unset();
+
+	int flags = (m == in) ? O_RDONLY : (m == out) ? O_WRONLY|O_CREAT : O_RDWR;
+
+#if defined(O_DIRECT)
+	// not every filesystem accepts O_DIRECT, nor every device the buffers
+	// rawaes has; those fall back to the cache
+	if (p.direct) {
+		fd = ::open(path, flags|O_DIRECT, 0666);
+		falign = (fd >= 0) ? direct_align(fd) : 0;
+
+		if (fd >= 0 && falign == 0) {
+			::close(fd);
+			fd = -1;
+		}
+
+		fdirect = (fd >= 0);
+		if (!fdirect) falign = page;
+	}
+#endif
+
+	if (fd < 0) fd = ::open(path, flags, 0666);
+	if (fd < 0) return B_ERROR;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) { unset(); return B_ERROR; }
+
+	flen = st.st_size;
+	fpath = path;
+	fcache = fdirect ? keep : p.cache;
+	fsync_policy = p.durability;
+	fsync_every = p.sync_every;
+	fsync_batch = p.sync_batch;
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+	// on Linux this also doubles the readahead window of the descriptor
+	if (fcache != keep) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	return B_OK;
+}
+
+void rawfile::unset(void)
+{
+	if (fd >= 0) ::close(fd);
+
+	fd = -1;
+	flen = 0;
+	fdirect = false;
+	falign = page;
+	fcache = keep;
+	wpos = 0;
+	wlen = 0;
+	fpath.clear();
+	fsync_policy = none;
+	fsync_every = 0;
+	fsync_batch = NULL;
+	wdirty = 0;
+}
+
+// Direct I/O needs whole aligned blocks, so requests are rounded up to the
+// next boundary, at least a page.  The caller's buffer must extend that
+// far; anything read past the requested length is ignored and anything
+// written past it is removed again when the output is truncated to its
+// final length.
+
+size_t rawfile::direct_round(const size_t len) const
+{
+	return fdirect ? (len + falign - 1) & ~(falign - 1) : len;
+}
+
+// A device may still turn direct I/O down when it is done, with EINVAL; the
+// descriptor then goes through the cache from there on.
+
+void rawfile::fall_back(void)
+{
+#if defined(O_DIRECT)
+	pthread_mutex_lock(&lock);
+
+	int flags = fcntl(fd, F_GETFL);
+	if (flags != -1) fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+	fdirect = false;
+
+	pthread_mutex_unlock(&lock);
+#endif
+}
+
+size_t rawfile::read_at(byte buf[], const size_t len, const off_t pos)
+{
+	bool direct = fdirect;
+	size_t alen = direct_round(len);
+	size_t done = 0;
+
+	while (done < alen) {
+		ssize_t r = pread(fd, buf + done, alen - done, pos + done);
+
+		if (r < 0 && errno == EINTR) continue;
+		if (r < 0 && errno == EINVAL && direct) {
+			fall_back();
+			direct = false;
+			continue;
+		}
+		if (r < 0) throw "Cannot Read Input File!";
+		if (r == 0) break;
+
+		done += r;
+	}
+
+	advise_read(pos, done);
+
+	return (done < len) ? done : len;
+}
+
+void rawfile::write_at(const byte buf[], const size_t len, const off_t pos)
+{
+	bool direct = fdirect;
+	size_t alen = direct_round(len);
+	size_t done = 0;
+
+	while (done < alen) {
+		ssize_t r = pwrite(fd, buf + done, alen - done, pos + done);
+
+		if (r < 0 && errno == EINTR) continue;
+		if (r < 0 && errno == EINVAL && direct) {
+			fall_back();
+			direct = false;
+			continue;
+		}
+		if (r <= 0) throw "Cannot Write Output File!";
+
+		done += r;
+	}
+
+	pthread_mutex_lock(&lock);
+	if (pos + static_cast<off_t>(len) > flen) flen = pos + len;
+	advise_write(pos, len);
+	pthread_mutex_unlock(&lock);
+}
+
+// The vectored forms move a small header and its data in one system call.
+// They are meant for buffered descriptors; direct I/O would need the header
+// to fill whole pages.
+
+size_t rawfile::read_at(byte head[], const size_t hlen, byte buf[], const size_t len,
+	const off_t pos)
+{
+	struct iovec	io[2] = { { head, hlen }, { buf, len } };
+	size_t			done = 0;
+
+	while (done < hlen + len) {
+		int first = (done < hlen) ? 0 : 1;
+		size_t skip = (first == 0) ? done : done - hlen;
+
+		io[first].iov_base = static_cast<byte*>(io[first].iov_base) + skip;
+		io[first].iov_len -= skip;
+
+		ssize_t r = preadv(fd, io + first, 2 - first, pos + done);
+
+		io[first].iov_base = static_cast<byte*>(io[first].iov_base) - skip;
+		io[first].iov_len += skip;
+
+		if (r < 0 && errno == EINTR) continue;
+		if (r < 0) throw "Cannot Read Input File!";
+		if (r == 0) break;
+
+		done += r;
+	}
+
+	advise_read(pos, done);
+
+	return done;
+}
+
+void rawfile::write_at(const byte head[], const size_t hlen, const byte buf[],
+	const size_t len, const off_t pos)
+{
+	struct iovec	io[2] = { { const_cast<byte*>(head), hlen }, { const_cast<byte*>(buf), len } };
+	size_t			done = 0;
+
+	while (done < hlen + len) {
+		int first = (done < hlen) ? 0 : 1;
+		size_t skip = (first == 0) ? done : done - hlen;
+
+		io[first].iov_base = static_cast<byte*>(io[first].iov_base) + skip;
+		io[first].iov_len -= skip;
+
+		ssize_t r = pwritev(fd, io + first, 2 - first, pos + done);
+
+		io[first].iov_base = static_cast<byte*>(io[first].iov_base) - skip;
+		io[first].iov_len += skip;
+
+		if (r < 0 && errno == EINTR) continue;
+		if (r <= 0) throw "Cannot Write Output File!";
+
+		done += r;
+	}
+
+	pthread_mutex_lock(&lock);
+	if (pos + static_cast<off_t>(hlen + len) > flen) flen = pos + hlen + len;
+	advise_write(pos, hlen + len);
+	pthread_mutex_unlock(&lock);
+}
+
+// A sequential reader asks for the next few buffers to be read ahead while
+// it works on this one, and under the drop policy hands back the pages it
+// has just consumed, so the page cache footprint stays flat however large
+// the input is.
+
+void rawfile::advise_read(const off_t pos, const size_t len)
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+	if (fcache == keep || len == 0) return;
+
+	posix_fadvise(fd, pos + len, 4 * buffer, POSIX_FADV_WILLNEED);
+	if (fcache == drop) posix_fadvise(fd, pos, len, POSIX_FADV_DONTNEED);
+#else
+	(void)pos; (void)len;
+#endif
+}
+
+// Dirty pages cannot be dropped until they are on disk.  Writeback of each
+// range is started as soon as it is written; by the time the next range
+// arrives it has usually finished, so waiting on it is cheap and its pages
+// can then be released.
+
+void rawfile::advise_write(const off_t pos, const size_t len)
+{
+#if defined(SYNC_FILE_RANGE_WRITE)
+	// the periodic policy keeps the amount of dirty data bounded
+	wdirty += len;
+	if (fsync_policy == periodic && wdirty >= fsync_every) {
+		sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+		wdirty = 0;
+	}
+#endif
+
+#if defined(SYNC_FILE_RANGE_WRITE) && defined(POSIX_FADV_DONTNEED)
+	if (fcache != drop) return;
+
+	sync_file_range(fd, pos, len, SYNC_FILE_RANGE_WRITE);
+
+	if (wlen != 0) {
+		sync_file_range(fd, wpos, wlen,
+			SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE|SYNC_FILE_RANGE_WAIT_AFTER);
+		posix_fadvise(fd, wpos, wlen, POSIX_FADV_DONTNEED);
+	}
+
+	wpos = pos;
+	wlen = len;
+#else
+	(void)pos; (void)len;
+#endif
+}
+
+// Holes are found with SEEK_HOLE and SEEK_DATA.  Where those are not
+// supported a file has no holes and every byte of it counts as data.
+
+bool rawfile::sparse(void)
+{
+#if defined(SEEK_HOLE)
+	off_t at = lseek(fd, 0, SEEK_HOLE);
+	return at >= 0 && at < flen;
+#else
+	return false;
+#endif
+}
+
+off_t rawfile::data_from(const off_t pos)
+{
+#if defined(SEEK_DATA)
+	off_t at = lseek(fd, pos, SEEK_DATA);
+	if (at >= 0) return at;
+	if (errno == ENXIO) return flen;	// nothing but a hole to the end
+#endif
+	return pos;
+}
+
+// Frees the blocks under a range, leaving the length alone.  Returns false
+// if the filesystem cannot, in which case the caller writes zeros instead.
+
+bool rawfile::punch(const off_t pos, const off_t len)
+{
+#if defined(FALLOC_FL_PUNCH_HOLE)
+	return len == 0 || fallocate(fd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE, pos, len) == 0;
+#else
+	(void)pos; (void)len;
+	return false;
+#endif
+}
+
+// Reserving the whole output before the first write lets the filesystem
+// hand out a few large extents instead of growing the file piecemeal.
+// Filesystems without support simply keep allocating on demand.
+
+void rawfile::preallocate(const off_t len)
+{
+#if defined(__linux__)
+	if (len > flen && fallocate(fd, 0, 0, len) == 0) flen = len;
+#else
+	(void)len;
+#endif
+}
+
+void rawfile::truncate(const off_t len)
+{
+	if (ftruncate(fd, len) != 0) throw "Cannot Resize Output File!";
+
+	flen = len;
+}
+
+void rawfile::preserve(const struct stat& st)
+{
+	struct timespec times[2] = { st.st_atim, st.st_mtim };
+
+	if (fchmod(fd, st.st_mode & 07777) != 0 || futimens(fd, times) != 0)
+		throw "Cannot Set Output Attributes!";
+}
+
+static int data_sync(const int fd)
+{
+#if defined(__linux__)
+	return fdatasync(fd);
+#else
+	return fsync(fd);
+#endif
+}
+
+// A new file is only reachable after a crash once the directory holding
+// it has been synced as well.
+
+static std::string parent_dir(const std::string& path)
+{
+	std::string::size_type slash = path.rfind('/');
+
+	if (slash == std::string::npos) return ".";
+	if (slash == 0) return "/";
+	return path.substr(0, slash);
+}
+
+static void dir_sync(const std::string& dir)
+{
+	int dfd = ::open(dir.c_str(), O_RDONLY);
+	if (dfd < 0) return;
+
+	fsync(dfd);
+	::close(dfd);
+}
+
+void rawfile::sync(void)
+{
+	if (fsync_policy == none) return;
+
+	if (fsync_policy == batch && fsync_batch != NULL) {
+		int bfd = dup(fd);
+		if (bfd < 0) throw "Cannot Sync Output File!";
+
+#if defined(SYNC_FILE_RANGE_WRITE)
+		sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+#endif
+		fsync_batch->add(bfd, parent_dir(fpath));
+		return;
+	}
+
+	if (data_sync(fd) != 0) throw "Cannot Sync Output File!";
+	dir_sync(parent_dir(fpath));
+}
+
+// Some callers need the data on disk at a given point, such as before a
+// checkpoint says it is there, whether or not the output is to be synced.
+
+void rawfile::datasync(void)
+{
+	if (data_sync(fd) != 0) throw "Cannot Sync Output File!";
+}
+
+// After a rename, which is only durable once the directory is synced.
+
+void rawfile::sync_dir(const char* path)
+{
+	dir_sync(parent_dir(path));
+}
+
+rawbuffers::rawbuffers(void)
+{
+	pthread_mutex_init(&lock, NULL);
+}
+
+rawbuffers::~rawbuffers(void)
+{
+	for (size_t i = 0; i < all.size(); ++i) std::free(all[i]);
+
+	pthread_mutex_destroy(&lock);
+}
+
+byte* rawbuffers::get(void)
+{
+	byte* buf = NULL;
+
+	pthread_mutex_lock(&lock);
+	if (!free.empty()) {
+		buf = free.back();
+		free.pop_back();
+	}
+	pthread_mutex_unlock(&lock);
+
+	if (buf != NULL) return buf;
+
+	void* mem;
+	if (posix_memalign(&mem, rawfile::page, rawfile::buffer) != 0) throw "Out of Memory!";
+
+	buf = static_cast<byte*>(mem);
+
+	pthread_mutex_lock(&lock);
+	all.push_back(buf);
+	pthread_mutex_unlock(&lock);
+
+	return buf;
+}
+
+void rawbuffers::put(byte* buf)
+{
+	pthread_mutex_lock(&lock);
+	free.push_back(buf);
+	pthread_mutex_unlock(&lock);
+}
+
+rawsync::rawsync(void)
+{
+	pthread_mutex_init(&lock, NULL);
+}
+
+rawsync::~rawsync(void)
+{
+	try { flush(); } catch (const char*) {}
+
+	pthread_mutex_destroy(&lock);
+}
+
+void rawsync::add(const int fd, const std::string& dir)
+{
+	pthread_mutex_lock(&lock);
+	fds.push_back(fd);
+	dirs.insert(dir);
+	bool full = (fds.size() >= limit);
+	pthread_mutex_unlock(&lock);
+
+	if (full) flush();
+}
+
+void rawsync::flush(void)
+{
+	std::vector<int>		f;
+	std::set<std::string>	d;
+
+	pthread_mutex_lock(&lock);
+	f.swap(fds);
+	d.swap(dirs);
+	pthread_mutex_unlock(&lock);
+
+	bool failed = false;
+
+	for (size_t i = 0; i < f.size(); ++i) {
+		if (data_sync(f[i]) != 0) failed = true;
+		::close(f[i]);
+	}
+
+	for (std::set<std::string>::iterator i = d.begin(); i != d.end(); ++i) dir_sync(*i);
+
+	if (failed) throw "Cannot Sync Output File!";
+}
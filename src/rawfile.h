@@ -0,0 +1,193 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawfile.h                                    (file 12) |
+|********************************************************/
+
+#if !defined(rawfile_h)
+#define rawfile_h
+
+#include <pthread.h>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "aes.h"
+#include <be/support/SupportDefs.h>
+
+class rawsync;
+
+// Numbers stored in rawaes files are little endian, whatever the host.
+
+inline void uint32_out(byte x[], const uint32 v)
+{	for (int i = 0; i < 4; ++i) x[i] = static_cast<byte>(v >> (8 * i));	}
+
+inline void uint64_out(byte x[], const uint64 v)
+{	for (int i = 0; i < 8; ++i) x[i] = static_cast<byte>(v >> (8 * i));	}
+
+inline uint32 uint32_in(const byte x[])
+{	uint32 v = 0; for (int i = 3; i >= 0; --i) v = (v << 8) | x[i]; return v;	}
+
+inline uint64 uint64_in(const byte x[])
+{	uint64 v = 0; for (int i = 7; i >= 0; --i) v = (v << 8) | x[i]; return v;	}
+
+// rawfile is a thin wrapper around a POSIX file descriptor.  Unlike BFile
+// it addresses the file by absolute offset, so the output can be written
+// in large pieces into space that was reserved up front, and several
+// threads may read and write different parts of one file at once.
+
+class rawfile
+{
+public:
+	enum rawfile_const	{	block  = 16,		// the AES block size in bytes
+							page   = 4096,		// alignment of I/O buffers, and the
+												// least direct I/O is aligned to
+							buffer = 1 << 20	// bytes moved per read or write
+						};
+
+	enum rawfile_mode	{	in  = 1,			// open an existing file for reading
+							out = 2,			// create or reuse a file for writing
+							update = 3			// read and rewrite an existing file
+						};
+
+	enum rawfile_cache	{	keep = 0,			// leave caching to the system
+							sequential = 1,		// hint sequential access, read ahead
+							drop = 2			// as sequential, then drop used pages
+						};
+
+	enum rawfile_sync	{	none = 0,			// no durability guarantee at all
+							file = 1,			// fdatasync the output when done
+							periodic = 2,		// as file, writing back every few MB
+							batch = 3			// fdatasync a whole batch at once
+						};
+
+	struct policy						// how the file is to be accessed
+	{
+		bool		direct;				// bypass the page cache (O_DIRECT)
+		rawfile_cache	cache;			// page cache hints when not direct
+		rawfile_sync	durability;		// what sync() does with the output
+		off_t		sync_every;			// bytes between periodic writebacks
+		rawsync*	sync_batch;			// collects outputs under the batch policy
+
+		policy(void) : direct(false), cache(keep), durability(none),
+			sync_every(64 << 20), sync_batch(NULL) {};
+
+		// the same, but through the page cache, for files moved in pieces
+		// that direct I/O cannot align
+		policy	buffered(void) const	{ policy p = *this; p.direct = false; return p; };
+	};
+
+	rawfile(void) : fd(-1), flen(0), fdirect(false), falign(page), fcache(keep), wpos(0), wlen(0),
+		fsync_policy(none), fsync_every(0), fsync_batch(NULL), wdirty(0)
+		{ pthread_mutex_init(&lock, NULL); };
+   ~rawfile(void)	{ unset(); pthread_mutex_destroy(&lock); };
+
+	status_t	open(const char* path, const rawfile_mode m, const policy& p = policy());
+	void		unset(void);
+
+	off_t		size(void) const	{ return flen; };
+	bool		direct(void) const	{ return fdirect; };
+
+	size_t		read_at(byte buf[], const size_t len, const off_t pos);
+	void		write_at(const byte buf[], const size_t len, const off_t pos);
+
+	// as above, for a header and a body that lie back to back in the file
+	size_t		read_at(byte head[], const size_t hlen, byte buf[], const size_t len,
+					const off_t pos);
+	void		write_at(const byte head[], const size_t hlen, const byte buf[],
+					const size_t len, const off_t pos);
+
+	bool		sparse(void);					// true if the file has holes
+	off_t		data_from(const off_t pos);		// the next byte not in a hole
+	bool		punch(const off_t pos, const off_t len);	// make a hole if supported
+	void		preallocate(const off_t len);	// reserve extents, may be a no-op
+	void		truncate(const off_t len);		// set the exact final length
+	void		sync(void);						// make the output durable
+	void		datasync(void);					// fdatasync now, whatever the policy
+	static void	sync_dir(const char* path);		// fsync the directory holding path
+	void		preserve(const struct stat& st);	// copy mode and times from st
+
+private:
+	rawfile(const rawfile&);
+	rawfile&	operator=(const rawfile&);
+
+	int			fd;		// the underlying descriptor, -1 when unset
+	off_t		flen;	// the file length when opened or last resized
+	bool		fdirect;// true if the descriptor was opened with O_DIRECT
+	size_t		falign;	// what direct I/O lengths are rounded up to
+	rawfile_cache	fcache;	// the cache policy in effect
+	off_t		wpos;	// the last written range, still under writeback
+	size_t		wlen;
+	std::string	fpath;	// the path the file was opened with
+	rawfile_sync	fsync_policy;
+	off_t		fsync_every;
+	rawsync*	fsync_batch;
+	off_t		wdirty;	// bytes written since writeback was last started
+	pthread_mutex_t	lock;	// guards the above when threads share the file
+
+	size_t		direct_round(const size_t len) const;
+	void		fall_back(void);
+	void		advise_read(const off_t pos, const size_t len);
+	void		advise_write(const off_t pos, const size_t len);
+};
+
+// rawbuffers hands out I/O buffers of rawfile::buffer bytes, aligned to a
+// page so they can be used for direct I/O.  Buffers are allocated on first
+// demand and recycled on put(), so the pool grows only to the number of
+// buffers actually in flight at once.  It may be shared between threads.
+
+class rawbuffers
+{
+public:
+	rawbuffers(void);
+   ~rawbuffers(void);
+
+	byte*		get(void);
+	void		put(byte* buf);
+
+private:
+	rawbuffers(const rawbuffers&);
+	rawbuffers&	operator=(const rawbuffers&);
+
+	pthread_mutex_t		lock;
+	std::vector<byte*>	free;	// buffers ready to be handed out
+	std::vector<byte*>	all;	// every buffer the pool owns
+};
+
+// rawsync makes a batch of outputs durable together.  Each output has its
+// writeback started when it is finished, which lets the disk work on it
+// while the next file is encrypted, and the batch is flushed with one
+// fdatasync per file and one fsync per directory when it is full or ends.
+
+class rawsync
+{
+public:
+	enum rawsync_const	{	limit = 256	};	// outputs held before flushing
+
+	rawsync(void);
+   ~rawsync(void);
+
+	void		add(const int fd, const std::string& dir);	// takes the descriptor
+	void		flush(void);
+
+private:
+	rawsync(const rawsync&);
+	rawsync&	operator=(const rawsync&);
+
+	pthread_mutex_t			lock;
+	std::vector<int>		fds;	// outputs not yet synced
+	std::set<std::string>	dirs;	// directories holding them
+};
+
+#endif
@@ -0,0 +1,312 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawhash.cpp                                  (file 13) |
+|********************************************************/
+
+#include "rawhash.h"
+#include "rawfile.h"
+
+#include <cstring>
+#include <pthread.h>
+
+static const uint32 sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32 ror(const uint32 x, const int n)	{ return (x >> n) | (x << (32 - n)); }
+
+void sha256::reset(void)
+{
+	static const uint32 start[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(state, start, sizeof(state));
+	held = 0;
+	total = 0;
+}
+
+void sha256::compress(const byte buf[])
+{
+	uint32 w[64];
+
+	for (int i = 0; i < 16; ++i)
+		w[i] = (uint32(buf[4 * i]) << 24) | (uint32(buf[4 * i + 1]) << 16)
+			| (uint32(buf[4 * i + 2]) << 8) | uint32(buf[4 * i + 3]);
+
+	for (int i = 16; i < 64; ++i) {
+		uint32 s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32 s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32 a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32 e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (int i = 0; i < 64; ++i) {
+		uint32 t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+		uint32 t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256::update(const byte buf[], const size_t len)
+{
+	size_t done = 0;
+
+	total += len;
+
+	if (held != 0) {
+		size_t part = (len < block - held) ? len : block - held;
+
+		memcpy(pending + held, buf, part);
+		held += part;
+		done = part;
+
+		if (held < block) return;
+
+		compress(pending);
+		held = 0;
+	}
+
+	for (; len - done >= block; done += block) compress(buf + done);
+
+	memcpy(pending, buf + done, len - done);
+	held = len - done;
+}
+
+void sha256::final(byte digest[])
+{
+	uint64 bits = total * 8;
+	byte pad[block + 8];
+	size_t n = ((held < 56) ? 56 : 120) - held;
+
+	memset(pad, 0, sizeof(pad));
+	pad[0] = 0x80;
+	for (int i = 0; i < 8; ++i) pad[n + i] = static_cast<byte>(bits >> (56 - 8 * i));
+
+	update(pad, n + 8);
+
+	for (int i = 0; i < 8; ++i)
+		for (int j = 0; j < 4; ++j) digest[4 * i + j] = static_cast<byte>(state[i] >> (24 - 8 * j));
+
+	reset();
+}
+
+static const uint64 xxh64_p1 = 0x9E3779B185EBCA87ULL;
+static const uint64 xxh64_p2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 xxh64_p3 = 0x165667B19E3779F9ULL;
+static const uint64 xxh64_p4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64 xxh64_p5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64 rol64(const uint64 x, const int n)	{ return (x << n) | (x >> (64 - n)); }
+
+static inline uint64 xxh64_round(uint64 acc, const uint64 input)
+{
+	acc += input * xxh64_p2;
+	return rol64(acc, 31) * xxh64_p1;
+}
+
+static inline uint64 xxh64_merge(uint64 acc, const uint64 val)
+{
+	acc ^= xxh64_round(0, val);
+	return acc * xxh64_p1 + xxh64_p4;
+}
+
+void xxh64::reset(void)
+{
+	acc[0] = xxh64_p1 + xxh64_p2;
+	acc[1] = xxh64_p2;
+	acc[2] = 0;
+	acc[3] = 0 - xxh64_p1;
+	held = 0;
+	total = 0;
+}
+
+void xxh64::update(const byte buf[], const size_t len)
+{
+	size_t done = 0;
+
+	total += len;
+
+	if (held != 0) {
+		size_t part = (len < 32 - held) ? len : 32 - held;
+
+		memcpy(pending + held, buf, part);
+		held += part;
+		done = part;
+
+		if (held < 32) return;
+
+		for (int i = 0; i < 4; ++i) acc[i] = xxh64_round(acc[i], uint64_in(pending + 8 * i));
+		held = 0;
+	}
+
+	for (; len - done >= 32; done += 32)
+		for (int i = 0; i < 4; ++i) acc[i] = xxh64_round(acc[i], uint64_in(buf + done + 8 * i));
+
+	memcpy(pending, buf + done, len - done);
+	held = len - done;
+}
+
+uint64 xxh64::final(void)
+{
+	uint64 h;
+
+	if (total >= 32) {
+		h = rol64(acc[0], 1) + rol64(acc[1], 7) + rol64(acc[2], 12) + rol64(acc[3], 18);
+		for (int i = 0; i < 4; ++i) h = xxh64_merge(h, acc[i]);
+	}
+	else h = acc[2] + xxh64_p5;
+
+	h += total;
+
+	size_t i = 0;
+
+	for (; i + 8 <= held; i += 8) {
+		h ^= xxh64_round(0, uint64_in(pending + i));
+		h = rol64(h, 27) * xxh64_p1 + xxh64_p4;
+	}
+
+	if (i + 4 <= held) {
+		h ^= static_cast<uint64>(uint32_in(pending + i)) * xxh64_p1;
+		h = rol64(h, 23) * xxh64_p2 + xxh64_p3;
+		i += 4;
+	}
+
+	for (; i < held; ++i) {
+		h ^= pending[i] * xxh64_p5;
+		h = rol64(h, 11) * xxh64_p1;
+	}
+
+	h ^= h >> 33;
+	h *= xxh64_p2;
+	h ^= h >> 29;
+	h *= xxh64_p3;
+	h ^= h >> 32;
+
+	reset();
+	return h;
+}
+
+static uint32		crc32c_table[8][256];
+static pthread_once_t	crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init(void)
+{
+	for (uint32 i = 0; i < 256; ++i) {
+		uint32 c = i;
+		for (int k = 0; k < 8; ++k) c = (c >> 1) ^ ((c & 1) ? 0x82F63B78 : 0);
+		crc32c_table[0][i] = c;
+	}
+
+	for (uint32 i = 0; i < 256; ++i)
+		for (int t = 1; t < 8; ++t)
+			crc32c_table[t][i] = (crc32c_table[t - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[t - 1][i] & 0xff];
+}
+
+void crc32c::update(const byte buf[], const size_t len)
+{
+	pthread_once(&crc32c_once, crc32c_init);
+
+	uint32	c = crc;
+	size_t	i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		uint32 lo = c ^ uint32_in(buf + i);
+		uint32 hi = uint32_in(buf + i + 4);
+
+		c = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff]
+			^ crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24]
+			^ crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff]
+			^ crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+	}
+
+	for (; i < len; ++i) c = (c >> 8) ^ crc32c_table[0][(c ^ buf[i]) & 0xff];
+
+	crc = c;
+}
+
+checksum::checksum_kind checksum::parse(const char* name)
+{
+	if (strcmp(name, "xxh64") == 0) return xxh64_sum;
+	if (strcmp(name, "crc32c") == 0) return crc32c_sum;
+	if (strcmp(name, "sha256") == 0) return sha256_sum;
+	return none;
+}
+
+const char* checksum::name(void) const
+{
+	switch (kind) {
+		case xxh64_sum:		return "XXH64";
+		case crc32c_sum:	return "CRC32C";
+		case sha256_sum:	return "SHA256";
+		default:			return "NONE";
+	}
+}
+
+void checksum::update(const byte buf[], const size_t len)
+{
+	switch (kind) {
+		case xxh64_sum:		x.update(buf, len); break;
+		case crc32c_sum:	c.update(buf, len); break;
+		case sha256_sum:	s.update(buf, len); break;
+		default:			break;
+	}
+}
+
+std::string checksum::hex(void)
+{
+	static const char	digits[] = "0123456789abcdef";
+	byte				d[sha256::size];
+	size_t				n = 0;
+
+	switch (kind) {
+		case xxh64_sum: {
+			uint64 v = x.final();
+			for (n = 0; n < 8; ++n) d[n] = static_cast<byte>(v >> (56 - 8 * n));
+			break;
+		}
+		case crc32c_sum: {
+			uint32 v = c.final();
+			for (n = 0; n < 4; ++n) d[n] = static_cast<byte>(v >> (24 - 8 * n));
+			break;
+		}
+		case sha256_sum:
+			s.final(d);
+			n = sha256::size;
+			break;
+		default:
+			break;
+	}
+
+	std::string out;
+	for (size_t i = 0; i < n; ++i) {
+		out += digits[d[i] >> 4];
+		out += digits[d[i] & 15];
+	}
+
+	return out;
+}
@@ -0,0 +1,112 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawhash.h                                    (file 14) |
+|********************************************************/
+
+#if !defined(rawhash_h)
+#define rawhash_h
+
+#include <string>
+#include <sys/types.h>
+
+#include "aes.h"
+#include <be/support/SupportDefs.h>
+
+// SHA-256 (FIPS 180-2), for fingerprints and checksums.  Feed it any
+// number of update() calls, then final() gives the digest and starts over.
+
+class sha256
+{
+public:
+	enum sha256_const	{	size = 32,		// bytes in a digest
+							block = 64		// bytes hashed at a time
+						};
+
+	sha256(void)	{ reset(); };
+
+	void		reset(void);
+	void		update(const byte buf[], const size_t len);
+	void		final(byte digest[]);
+
+private:
+	uint32		state[8];
+	byte		pending[block];		// bytes not yet hashed
+	size_t		held;
+	uint64		total;				// bytes seen since reset()
+
+	void		compress(const byte buf[]);
+};
+
+// xxHash64 with a seed of 0, the fast non-cryptographic checksum.
+
+class xxh64
+{
+public:
+	xxh64(void)	{ reset(); };
+
+	void		reset(void);
+	void		update(const byte buf[], const size_t len);
+	uint64		final(void);
+
+private:
+	uint64		acc[4];
+	byte		pending[32];	// bytes not yet taken in
+	size_t		held;
+	uint64		total;
+};
+
+// CRC-32C (Castagnoli), the checksum of iSCSI and ext4, eight bytes at a
+// time from tables built on first use.
+
+class crc32c
+{
+public:
+	crc32c(void) : crc(0xffffffff) {};
+
+	void		reset(void)		{ crc = 0xffffffff; };
+	void		update(const byte buf[], const size_t len);
+	uint32		final(void)		{ uint32 v = ~crc; reset(); return v; };
+
+private:
+	uint32		crc;
+};
+
+// checksum runs whichever of the above was asked for, so a pass over the
+// data can feed it without knowing which, and gives the result in hex.
+
+class checksum
+{
+public:
+	enum checksum_kind	{	none = 0,
+							xxh64_sum = 1,
+							crc32c_sum = 2,
+							sha256_sum = 3
+						};
+
+	checksum(const checksum_kind k = none) : kind(k) {};
+
+	static checksum_kind	parse(const char* name);	// none if unknown
+
+	bool		active(void) const	{ return kind != none; };
+	const char*	name(void) const;
+	void		update(const byte buf[], const size_t len);
+	std::string	hex(void);		// the result so far, then starts over
+
+private:
+	checksum_kind	kind;
+	xxh64		x;
+	crc32c		c;
+	sha256		s;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawjob.cpp                                   (file 15) |
+|********************************************************/
+
+#include "rawjob.h"
+#include "rawstream.h"
+
+class rawjob_chunk : public rawtask
+{
+public:
+	rawjob_chunk(rawjob* j, const off_t p, const off_t l) : job(j), pos(p), len(l) {};
+	void	run(rawworker& w);
+
+private:
+	rawjob*		job;
+	off_t		pos;
+	off_t		len;
+};
+
+void rawjob_chunk::run(rawworker& w)
+{
+	const char*	error = NULL;
+	byte*		buf = w.pool->buffers().get();
+
+	try {
+		rawstream stream(w.crypto, job->enc);
+		stream.range(job->fin, job->fout, buf, pos, len);
+	} catch (const char* str) {
+		error = str;
+	}
+
+	w.pool->buffers().put(buf);
+	job->chunk_done(w, error);
+}
+
+rawjob::rawjob(const std::string& i, const bool e, const struct stat* s)
+	: enc(e), in(i), keep(s != NULL), remaining(0), error(NULL)
+{
+	if (keep) st = *s;
+}
+
+void rawjob::start(rawworker& w, const std::string& in, const std::string& out,
+	const rawfile::policy& io, const bool enc, const struct stat* st)
+{
+	rawjob* job = new rawjob(in, enc, st);
+
+	try {
+		if (job->fin.open(in.c_str(), rawfile::in, io) != B_OK) throw "Cannot Initialize Input File!";
+		if (job->fout.open(out.c_str(), rawfile::out, io) != B_OK) throw "Cannot Initialize Output File!";
+
+		off_t size = job->fin.size();
+
+		if (size <= chunk) {
+			rawstream stream(w.crypto, enc);
+			stream.run(job->fin, job->fout, w.pool->buffers());
+			job->finish();
+			delete job;
+			return;
+		}
+
+		job->fout.preallocate(rawstream::padded(size));
+		job->remaining = (size + chunk - 1) / chunk;
+	} catch (const char* str) {
+		w.pool->fail(in, str);
+		delete job;
+		return;
+	}
+
+	// count every chunk before the first can finish and complete the job
+	off_t size = job->fin.size();
+	for (off_t pos = 0; pos < size; pos += chunk)
+		w.pool->push(new rawjob_chunk(job, pos,
+			(size - pos < chunk) ? size - pos : static_cast<off_t>(chunk)), w);
+}
+
+void rawjob::chunk_done(rawworker& w, const char* err)
+{
+	if (err != NULL) __sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), err);
+	if (__sync_sub_and_fetch(&remaining, 1) != 0) return;
+
+	try {
+		if (error != NULL) throw error;
+
+		fout.truncate(rawstream::padded(fin.size()));
+		finish();
+	} catch (const char* str) {
+		w.pool->fail(in, str);
+	}
+
+	delete this;
+}
+
+void rawjob::finish(void)
+{
+	if (keep) fout.preserve(st);
+	fout.sync();
+
+	fin.unset();
+	fout.unset();
+}
@@ -0,0 +1,57 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawjob.h                                     (file 16) |
+|********************************************************/
+
+#if !defined(rawjob_h)
+#define rawjob_h
+
+#include <string>
+#include <sys/stat.h>
+
+#include "rawfile.h"
+#include "rawpool.h"
+
+// rawjob carries one file through the pool.  A small file is processed in
+// one go by the worker that opened it.  A large one is cut into chunks of
+// a fixed size, each a task of its own that any idle worker may steal;
+// whichever worker finishes the last chunk completes the file.
+
+class rawjob
+{
+public:
+	enum rawjob_const	{	chunk = 64 << 20	};	// bytes per chunk task
+
+	static void	start(rawworker& w, const std::string& in, const std::string& out,
+					const rawfile::policy& io, const bool enc, const struct stat* st);
+
+	void		chunk_done(rawworker& w, const char* error);
+
+private:
+	friend class rawjob_chunk;
+
+	rawjob(const std::string& i, const bool e, const struct stat* s);
+
+	rawfile		fin;
+	rawfile		fout;
+	bool		enc;
+	std::string	in;
+	bool		keep;		// true to copy st onto the output
+	struct stat	st;
+	size_t		remaining;	// chunks not yet finished
+	const char*	error;		// the first chunk failure, if any
+
+	void		finish(void);
+};
+
+#endif
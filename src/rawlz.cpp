@@ -0,0 +1,205 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawlz.cpp                                    (file 17) |
+|********************************************************/
+
+#include "rawlz.h"
+
+#include <cstring>
+
+static inline uint32 read32(const byte* p)
+{
+	uint32 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64 read64(const byte* p)
+{
+	uint64 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32 lz_hash(const uint32 seq)
+{
+	return (seq * 2654435761U) >> (32 - rawlz::hash_bits);
+}
+
+// Lengths of 15 or more spill over the token into bytes of 255, ending
+// with one below 255.
+
+static inline byte* put_length(byte* op, size_t len)
+{
+	for (; len >= 255; len -= 255) *op++ = 255;
+	*op++ = static_cast<byte>(len);
+	return op;
+}
+
+// Writes one sequence, or just the final literals if there is no match.
+// Returns NULL if it would run past end.
+
+static byte* put_sequence(byte* op, byte* end, const byte* lit, const size_t nlit,
+	const size_t distance, const size_t extra)
+{
+	// the worst case: token, literal length, literals, distance, match length
+	if (static_cast<size_t>(end - op) < 1 + nlit / 255 + 1 + nlit + 2 + extra / 255 + 1)
+		return NULL;
+
+	byte* token = op++;
+
+	*token = static_cast<byte>(((nlit < 15) ? nlit : 15) << 4);
+	if (nlit >= 15) op = put_length(op, nlit - 15);
+
+	memcpy(op, lit, nlit);
+	op += nlit;
+
+	if (distance == 0) return op;
+
+	*op++ = static_cast<byte>(distance);
+	*op++ = static_cast<byte>(distance >> 8);
+
+	*token |= static_cast<byte>((extra < 15) ? extra : 15);
+	if (extra >= 15) op = put_length(op, extra - 15);
+
+	return op;
+}
+
+// Looks for each position's first four bytes in a table of the positions
+// last seen with the same hash.  A run without a match is skipped over
+// faster the longer it goes on, so data that does not compress costs
+// little time.
+
+size_t rawlz::compress(const byte src[], const size_t len, byte dst[], const size_t room)
+{
+	uint32	table[1 << hash_bits];
+
+	const byte*	ip = src;
+	const byte*	anchor = src;
+	const byte*	end = src + len;
+	byte*		op = dst;
+	byte*		oend = dst + room;
+
+	memset(table, 0, sizeof(table));
+
+	if (len > limit) {
+		const byte*	starts = end - limit;	// the last place a match may start
+		const byte*	stops = end - tail;		// where every match must end by
+		size_t		misses = 0;
+
+		while (ip < starts) {
+			uint32		seq = read32(ip);
+			uint32		h = lz_hash(seq);
+			const byte*	ref = src + table[h];
+
+			table[h] = static_cast<uint32>(ip - src);
+
+			if (ref >= ip || ip - ref > 0xffff || read32(ref) != seq) {
+				ip += 1 + (misses++ >> 6);
+				continue;
+			}
+
+			misses = 0;
+
+			// the match may reach back into the literals before it
+			while (ip > anchor && ref > src && ip[-1] == ref[-1]) { --ip; --ref; }
+
+			const byte* m = ip + min_match;
+			const byte* r = ref + min_match;
+
+			while (m + 8 <= stops && read64(m) == read64(r)) { m += 8; r += 8; }
+			while (m < stops && *m == *r) { ++m; ++r; }
+
+			op = put_sequence(op, oend, anchor, ip - anchor, ip - ref, m - ip - min_match);
+			if (op == NULL) return 0;
+
+			ip = anchor = m;
+		}
+	}
+
+	op = put_sequence(op, oend, anchor, end - anchor, 0, 0);
+	if (op == NULL) return 0;
+
+	return op - dst;
+}
+
+static inline bool get_length(const byte*& ip, const byte* end, size_t& len)
+{
+	byte b;
+
+	do {
+		if (ip >= end) return false;
+		b = *ip++;
+		len += b;
+	} while (b == 255);
+
+	return true;
+}
+
+// Every length and distance is checked against both buffers, so damaged
+// or hostile input can only fail, never write out of bounds.
+
+bool rawlz::expand(const byte src[], const size_t slen, byte dst[], const size_t dlen)
+{
+	const byte*	ip = src;
+	const byte*	end = src + slen;
+	byte*		op = dst;
+	byte*		oend = dst + dlen;
+
+	while (ip < end) {
+		byte	token = *ip++;
+		size_t	nlit = token >> 4;
+
+		if (nlit == 15 && !get_length(ip, end, nlit)) return false;
+		if (nlit > static_cast<size_t>(end - ip) || nlit > static_cast<size_t>(oend - op)) return false;
+
+		memcpy(op, ip, nlit);
+		ip += nlit;
+		op += nlit;
+
+		// the last sequence has no match
+		if (ip == end) break;
+		if (end - ip < 2) return false;
+
+		size_t	distance = ip[0] | (ip[1] << 8);
+		size_t	mlen = token & 15;
+
+		ip += 2;
+
+		if (mlen == 15 && !get_length(ip, end, mlen)) return false;
+		mlen += min_match;
+
+		if (distance == 0 || distance > static_cast<size_t>(op - dst)
+			|| mlen > static_cast<size_t>(oend - op)) return false;
+
+		const byte* ref = op - distance;
+
+		// an overlapping match repeats its first distance bytes, which can
+		// be copied in runs that double each time
+		if (distance >= mlen) memcpy(op, ref, mlen);
+		else {
+			size_t done = distance;
+
+			memcpy(op, ref, distance);
+			while (done < mlen) {
+				size_t part = (done < mlen - done) ? done : mlen - done;
+				memcpy(op + done, op, part);
+				done += part;
+			}
+		}
+
+		op += mlen;
+	}
+
+	return op == oend;
+}
@@ -0,0 +1,49 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawlz.h                                      (file 18) |
+|********************************************************/
+
+#if !defined(rawlz_h)
+#define rawlz_h
+
+#include <sys/types.h>
+
+#include "aes.h"
+#include <be/support/SupportDefs.h>
+
+// A fast compressor for the chunks of a container, writing the LZ4 block
+// format: each sequence is a token, a run of literals, and a match given
+// as a distance back of up to 64K and a length.  It trades ratio for
+// speed, which suits text and logs well and lets a chunk be squeezed in
+// much less time than it takes to encrypt it.  Chunks are compressed on
+// their own, so every worker can compress a different one at once.
+
+class rawlz
+{
+public:
+	enum rawlz_const	{	hash_bits = 14,		// positions remembered while compressing
+							min_match = 4,		// the shortest match worth a sequence
+							tail = 5,			// the last bytes are always literals
+							limit = 12			// no match starts this close to the end
+						};
+
+	// Compresses len bytes of src into dst, which has room bytes.  Returns
+	// the compressed length, or 0 if it would not fit in room.
+	static size_t	compress(const byte src[], const size_t len, byte dst[], const size_t room);
+
+	// Expands slen compressed bytes into dst, which must come out at
+	// exactly dlen bytes.  Returns false if the data is damaged.
+	static bool		expand(const byte src[], const size_t slen, byte dst[], const size_t dlen);
+};
+
+#endif
@@ -0,0 +1,212 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawpool.cpp                                  (file 19) |
+|********************************************************/
+
+#include "rawpool.h"
+
+#include <iostream>
+#include <new>
+#include <unistd.h>
+
+rawpool::rawpool(const aes& crypto, const size_t count)
+	: queued(0), pending(0), next(0), failed(0), lost(0), stop(false)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&work, NULL);
+	pthread_cond_init(&idle, NULL);
+
+	size_t n = (count < 1) ? 1 : count;
+
+	// the workers must not move once their threads have started
+	workers.resize(n);
+
+	for (size_t i = 0; i < n; ++i) {
+		workers[i].crypto = crypto;
+		workers[i].pool = this;
+		workers[i].index = i;
+		pthread_mutex_init(&workers[i].lock, NULL);
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		pthread_t thread;
+
+		if (pthread_create(&thread, NULL, entry, &workers[i]) != 0) {
+			shutdown();
+			throw "Cannot Start Thread!";
+		}
+
+		threads.push_back(thread);
+	}
+}
+
+rawpool::~rawpool(void)
+{
+	shutdown();
+}
+
+void rawpool::shutdown(void)
+{
+	pthread_mutex_lock(&lock);
+	stop = true;
+	pthread_cond_broadcast(&work);
+	pthread_mutex_unlock(&lock);
+
+	for (size_t i = 0; i < threads.size(); ++i) pthread_join(threads[i], NULL);
+	threads.clear();
+
+	for (size_t i = 0; i < workers.size(); ++i) {
+		for (size_t j = 0; j < workers[i].tasks.size(); ++j) delete workers[i].tasks[j];
+		pthread_mutex_destroy(&workers[i].lock);
+	}
+	workers.clear();
+
+	pthread_cond_destroy(&idle);
+	pthread_cond_destroy(&work);
+	pthread_mutex_destroy(&lock);
+}
+
+size_t rawpool::cpus(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n < 1) ? 1 : static_cast<size_t>(n);
+}
+
+void rawpool::push(rawtask* t)
+{
+	pthread_mutex_lock(&lock);
+	rawworker& w = workers[next++ % workers.size()];
+	pthread_mutex_unlock(&lock);
+
+	push(t, w);
+}
+
+void rawpool::push(rawtask* t, rawworker& w)
+{
+	pthread_mutex_lock(&w.lock);
+	w.tasks.push_back(t);
+	pthread_mutex_unlock(&w.lock);
+
+	pthread_mutex_lock(&lock);
+	++queued;
+	++pending;
+	pthread_cond_signal(&work);
+	pthread_mutex_unlock(&lock);
+}
+
+// A task cut short by anything but a message may have left its caller's
+// work half done without the caller knowing, so wait() reports it.
+
+void rawpool::wait(void)
+{
+	pthread_mutex_lock(&lock);
+	while (pending != 0) pthread_cond_wait(&idle, &lock);
+	bool broken = lost != 0;
+	lost = 0;
+	pthread_mutex_unlock(&lock);
+
+	if (broken) throw "A Worker Task Failed!";
+}
+
+// Failures are reported as they happen and counted; the remaining tasks
+// carry on.
+
+void rawpool::fail(const std::string& what, const char* why)
+{
+	pthread_mutex_lock(&lock);
+	std::cout << std::endl << what << ": " << why << std::flush;
+	++failed;
+	pthread_mutex_unlock(&lock);
+}
+
+void rawpool::lose(const char* why)
+{
+	fail("rawaes", why);
+
+	pthread_mutex_lock(&lock);
+	++lost;
+	pthread_mutex_unlock(&lock);
+}
+
+void* rawpool::entry(void* data)
+{
+	rawworker* w = static_cast<rawworker*>(data);
+
+	w->pool->loop(*w);
+	return NULL;
+}
+
+// The newest task of the worker's own queue is the one most likely to find
+// its data still in cache; the oldest task of another queue is the one its
+// owner would have reached last.
+
+rawtask* rawpool::take(rawworker& w)
+{
+	rawtask* t = NULL;
+
+	pthread_mutex_lock(&w.lock);
+	if (!w.tasks.empty()) {
+		t = w.tasks.back();
+		w.tasks.pop_back();
+	}
+	pthread_mutex_unlock(&w.lock);
+
+	for (size_t i = 1; t == NULL && i < workers.size(); ++i) {
+		rawworker& v = workers[(w.index + i) % workers.size()];
+
+		pthread_mutex_lock(&v.lock);
+		if (!v.tasks.empty()) {
+			t = v.tasks.front();
+			v.tasks.pop_front();
+		}
+		pthread_mutex_unlock(&v.lock);
+	}
+
+	return t;
+}
+
+void rawpool::loop(rawworker& w)
+{
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		while (queued == 0 && !stop) pthread_cond_wait(&work, &lock);
+		bool done = stop;
+		pthread_mutex_unlock(&lock);
+
+		if (done) break;
+
+		rawtask* t = take(w);
+		if (t == NULL) continue;	// another worker got there first
+
+		pthread_mutex_lock(&lock);
+		--queued;
+		pthread_mutex_unlock(&lock);
+
+		try {
+			t->run(w);
+		} catch (const char* str) {
+			fail("rawaes", str);
+		} catch (const std::bad_alloc&) {
+			lose("Out of Memory!");
+		} catch (...) {
+			lose("Unexpected Error!");
+		}
+
+		delete t;
+
+		pthread_mutex_lock(&lock);
+		if (--pending == 0) pthread_cond_broadcast(&idle);
+		pthread_mutex_unlock(&lock);
+	}
+}
@@ -0,0 +1,106 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawpool.h                                    (file 20) |
+|********************************************************/
+
+#if !defined(rawpool_h)
+#define rawpool_h
+
+#include <deque>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "aes.h"
+#include "rawfile.h"
+#include <be/support/SupportDefs.h>
+
+class rawpool;
+
+class rawtask;
+
+// Each worker thread owns a copy of the expanded key schedule, so no state
+// is shared between threads while they encrypt.  It also owns a queue of
+// tasks: the worker takes the newest task from its own queue, and when that
+// runs dry it steals the oldest task from another worker's queue.
+
+struct rawworker
+{
+	aes			crypto;		// this worker's own key schedule
+	rawpool*	pool;		// the pool the worker belongs to
+	size_t		index;		// 0 .. threads - 1
+
+	pthread_mutex_t			lock;
+	std::deque<rawtask*>	tasks;
+};
+
+// A unit of work.  Tasks may push further tasks into the pool while they
+// run; the pool deletes each task once it has run.
+
+class rawtask
+{
+public:
+	virtual		~rawtask(void) {};
+	virtual void	run(rawworker& w) = 0;
+};
+
+// rawpool runs tasks on a fixed set of worker threads.  Work pushed from
+// outside is dealt out to the workers in turn; work pushed by a running
+// task stays with its worker until someone idle steals it, so a task that
+// splits a large file into chunks keeps every thread busy.  wait() returns
+// once every task pushed so far, and every task those pushed, is done; it
+// throws if any of them ended on an exception other than a message.
+
+class rawpool
+{
+public:
+	rawpool(const aes& crypto, const size_t threads);
+   ~rawpool(void);
+
+	static size_t	cpus(void);		// the number of processors online
+
+	void		push(rawtask* t);					// from outside the pool
+	void		push(rawtask* t, rawworker& w);		// from a task running on w
+	void		wait(void);
+	void		fail(const std::string& what, const char* why);
+
+	rawbuffers&	buffers(void)		{ return pool; };
+	size_t		size(void) const	{ return workers.size(); };
+	size_t		failures(void) const	{ return failed; };
+
+private:
+	rawpool(const rawpool&);
+	rawpool&	operator=(const rawpool&);
+
+	pthread_mutex_t			lock;
+	pthread_cond_t			work;	// signalled when tasks arrive or on exit
+	pthread_cond_t			idle;	// signalled when the last task finishes
+	size_t					queued;	// tasks waiting in any worker's queue
+	size_t					pending;// tasks pushed but not yet finished
+	size_t					next;	// the worker given the next outside task
+	size_t					failed;
+	size_t					lost;	// tasks ended by an unexpected exception
+	bool					stop;
+
+	std::vector<pthread_t>	threads;
+	std::vector<rawworker>	workers;
+	rawbuffers				pool;
+
+	static void*	entry(void* data);
+	void			loop(rawworker& w);
+	rawtask*		take(rawworker& w);
+	void			lose(const char* why);
+	void			shutdown(void);
+};
+
+#endif
@@ -0,0 +1,281 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawreader.cpp                                (file 21) |
+|********************************************************/
+
+#include "rawreader.h"
+#include "rawstream.h"
+
+#include <cstring>
+
+class rawreader_fetch : public rawtask
+{
+public:
+	rawreader_fetch(rawreader& r, const uint64 i) : reader(r), index(i) {};
+	void	run(rawworker& w) { reader.fetch(w.crypto, index); };
+
+private:
+	rawreader&	reader;
+	uint64		index;
+};
+
+rawreader::rawreader(const aes& c, const int bits, rawfile& f, const size_t cache,
+	rawpool* workers)
+	: crypto(c), in(f), cont(NULL), length(0), csize(rawfile::buffer), limit(1),
+	pool(workers), next(0), run(0), queued(0), inflight(0), hit(0), missed(0)
+{
+	if (rawcont::detect(in)) {
+		cont = new rawcont(crypto, bits);
+
+		try {
+			cont->open(in);
+		} catch (...) {
+			delete cont;
+			throw;
+		}
+
+		length = cont->length();
+		csize = cont->chunk();
+	}
+	else length = in.size();
+
+	if (cache > shards) limit = (cache + shards - 1) / shards;
+
+	// the shards must not move once their locks are set up
+	table.resize(shards);
+
+	for (size_t i = 0; i < table.size(); ++i) {
+		pthread_mutex_init(&table[i].lock, NULL);
+		pthread_cond_init(&table[i].loaded, NULL);
+	}
+
+	pthread_mutex_init(&state, NULL);
+	pthread_cond_init(&settled, NULL);
+}
+
+rawreader::~rawreader(void)
+{
+	// readahead tasks still refer to the reader
+	pthread_mutex_lock(&state);
+	while (inflight != 0) pthread_cond_wait(&settled, &state);
+	pthread_mutex_unlock(&state);
+
+	for (size_t i = 0; i < table.size(); ++i) {
+		pthread_mutex_destroy(&table[i].lock);
+		pthread_cond_destroy(&table[i].loaded);
+	}
+
+	pthread_mutex_destroy(&state);
+	pthread_cond_destroy(&settled);
+
+	delete cont;
+}
+
+// Reads up to len bytes of plaintext from pos onwards into buf, returning
+// how many were read; fewer than len only at the end of the file.
+
+size_t rawreader::pread(byte buf[], const size_t len, const uint64 pos)
+{
+	if (pos >= length) return 0;
+
+	size_t	want = (len < length - pos) ? len : length - pos;
+	size_t	done = 0;
+	aes		schedule(crypto);
+
+	while (done < want) {
+		uint64	at = pos + done;
+		uint64	i = at / csize;
+		size_t	off = at - i * csize;
+		size_t	part = (csize - off < want - done) ? csize - off : want - done;
+
+		size_t got = get(schedule, i, buf + done, off, part);
+
+		done += got;
+		if (got < part) break;
+	}
+
+	readahead(pos, done);
+
+	return done;
+}
+
+// Copies len bytes from off in chunk i, from the cache if it is there.
+
+size_t rawreader::get(aes& schedule, const uint64 i, byte buf[], const size_t off, const size_t len)
+{
+	shard& s = table[i % shards];
+
+	pthread_mutex_lock(&s.lock);
+
+	for (;;) {
+		std::map<uint64, std::list<entry>::iterator>::iterator e = s.where.find(i);
+
+		if (e != s.where.end()) {
+			s.lru.splice(s.lru.begin(), s.lru, e->second);
+
+			const std::vector<byte>& data = e->second->data;
+			size_t n = (off < data.size()) ? data.size() - off : 0;
+			if (n > len) n = len;
+			if (n != 0) memcpy(buf, &data[off], n);
+
+			pthread_mutex_unlock(&s.lock);
+			__sync_fetch_and_add(&hit, 1);
+			return n;
+		}
+
+		if (s.loading.count(i) == 0) break;
+
+		pthread_cond_wait(&s.loaded, &s.lock);
+	}
+
+	s.loading.insert(i);
+	pthread_mutex_unlock(&s.lock);
+
+	__sync_fetch_and_add(&missed, 1);
+
+	return fill(schedule, i, buf, off, len);
+}
+
+// Marks chunk i as being loaded, unless it is cached or on its way.
+
+bool rawreader::reserve(const uint64 i)
+{
+	shard& s = table[i % shards];
+
+	pthread_mutex_lock(&s.lock);
+	bool free = s.where.count(i) == 0 && s.loading.count(i) == 0;
+	if (free) s.loading.insert(i);
+	pthread_mutex_unlock(&s.lock);
+
+	return free;
+}
+
+// Decrypts a reserved chunk outside the lock and caches it, copying len
+// bytes from off into buf on the way if buf is given.
+
+size_t rawreader::fill(aes& schedule, const uint64 i, byte buf[], const size_t off, const size_t len)
+{
+	shard& s = table[i % shards];
+	entry e;
+
+	e.index = i;
+
+	try {
+		load(schedule, i, e.data);
+	} catch (...) {
+		pthread_mutex_lock(&s.lock);
+		s.loading.erase(i);
+		pthread_cond_broadcast(&s.loaded);
+		pthread_mutex_unlock(&s.lock);
+		throw;
+	}
+
+	size_t n = (off < e.data.size()) ? e.data.size() - off : 0;
+	if (n > len) n = len;
+	if (buf != NULL && n != 0) memcpy(buf, &e.data[off], n);
+
+	pthread_mutex_lock(&s.lock);
+
+	s.loading.erase(i);
+	s.lru.push_front(entry());
+	s.lru.front().index = i;
+	s.lru.front().data.swap(e.data);
+	s.where[i] = s.lru.begin();
+
+	while (s.lru.size() > limit) {
+		s.where.erase(s.lru.back().index);
+		s.lru.pop_back();
+	}
+
+	pthread_cond_broadcast(&s.loaded);
+	pthread_mutex_unlock(&s.lock);
+
+	return n;
+}
+
+void rawreader::load(aes& schedule, const uint64 i, std::vector<byte>& data)
+{
+	if (cont != NULL) {
+		data.resize(csize);
+		data.resize(cont->read_chunk(schedule, in, i, &data[0]));
+		return;
+	}
+
+	uint64	start = i * csize;
+	size_t	len = (length - start < csize) ? length - start : csize;
+
+	// a damaged file may end mid-block; the rest of the block reads as 0s
+	data.assign(rawstream::padded(len), 0);
+	in.read_at(&data[0], len, start);
+
+	rawstream stream(schedule, false);
+	stream.crypt(&data[0], data.size());
+	data.resize(len);
+}
+
+void rawreader::fetch(aes& schedule, const uint64 i)
+{
+	try {
+		fill(schedule, i, NULL, 0, 0);
+	} catch (...) {
+		// the reader will meet the same error, and report it, on demand
+	}
+
+	pthread_mutex_lock(&state);
+	--inflight;
+	pthread_cond_broadcast(&settled);
+	pthread_mutex_unlock(&state);
+}
+
+// A read that starts where the last one ended continues a streak; once the
+// streak is long enough the chunks after this read are decrypted on the
+// pool before they are asked for.
+
+void rawreader::readahead(const uint64 pos, const size_t len)
+{
+	if (pool == NULL || len == 0) return;
+
+	uint64 first = (pos + len - 1) / csize + 1;
+	uint64 count = (length + csize - 1) / csize;
+	uint64 end = (first + ahead < count) ? first + ahead : count;
+
+	pthread_mutex_lock(&state);
+
+	if (pos != next) {
+		run = 0;
+		queued = 0;
+	}
+	else ++run;
+
+	next = pos + len;
+
+	if (run < streak || end <= queued) {
+		pthread_mutex_unlock(&state);
+		return;
+	}
+
+	uint64 from = (first > queued) ? first : queued;
+	queued = end;
+
+	pthread_mutex_unlock(&state);
+
+	for (uint64 i = from; i < end; ++i) {
+		if (!reserve(i)) continue;
+
+		pthread_mutex_lock(&state);
+		++inflight;
+		pthread_mutex_unlock(&state);
+
+		pool->push(new rawreader_fetch(*this, i));
+	}
+}
@@ -0,0 +1,114 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawreader.h                                  (file 22) |
+|********************************************************/
+
+#if !defined(rawreader_h)
+#define rawreader_h
+
+#include <list>
+#include <map>
+#include <pthread.h>
+#include <set>
+#include <sys/types.h>
+#include <vector>
+
+#include "aes.h"
+#include "rawcont.h"
+#include "rawfile.h"
+#include "rawpool.h"
+#include <be/support/SupportDefs.h>
+
+// rawreader gives random access to the plaintext of an encrypted file, a
+// container or a plain rawaes file, for callers that read it piecemeal.
+// Any number of threads may call pread() at once.  rawaes itself reads
+// --offset and --length of a plain rawaes file through one.
+//
+// Decrypted chunks (the container's, or rawfile::buffer bytes of a plain
+// file) are kept in an LRU cache split into shards, each under its own
+// lock, so overlapping reads decrypt a chunk only once and readers of
+// different chunks rarely meet.  A chunk being decrypted is marked as such
+// and anyone else wanting it waits for it rather than decrypting it again.
+// When reads run on from one another and a pool is given, the next few
+// chunks are decrypted on the pool ahead of the reader.
+//
+// The file must not have been opened for direct I/O.
+
+class rawreader
+{
+public:
+	enum rawreader_const	{	shards = 16,	// locks the cache is split over
+								ahead = 4,		// chunks decrypted ahead of the reader
+								streak = 2		// reads in a row that count as sequential
+							};
+
+	rawreader(const aes& c, const int bits, rawfile& f, const size_t cache = 64,
+		rawpool* workers = NULL);
+   ~rawreader(void);
+
+	uint64		size(void) const	{ return length; };		// the plaintext length
+	size_t		pread(byte buf[], const size_t len, const uint64 pos);
+
+	void		fetch(aes& schedule, const uint64 i);		// for readahead tasks
+
+	uint64		hits(void) const	{ return hit; };
+	uint64		misses(void) const	{ return missed; };
+
+private:
+	rawreader(const rawreader&);
+	rawreader&	operator=(const rawreader&);
+
+	struct entry
+	{
+		uint64				index;
+		std::vector<byte>	data;
+	};
+
+	struct shard
+	{
+		pthread_mutex_t		lock;
+		pthread_cond_t		loaded;		// signalled whenever a chunk arrives
+		std::list<entry>	lru;		// most recently used first
+		std::set<uint64>	loading;	// chunks being decrypted right now
+
+		std::map<uint64, std::list<entry>::iterator>	where;
+	};
+
+	aes			crypto;		// never used to encrypt, only copied
+	rawfile&	in;
+	rawcont*	cont;		// NULL for a plain rawaes file
+	uint64		length;
+	uint64		csize;		// plaintext bytes per chunk
+	size_t		limit;		// chunks cached per shard
+	rawpool*	pool;
+
+	std::vector<shard>	table;
+
+	pthread_mutex_t	state;		// guards the readahead state below
+	pthread_cond_t	settled;	// signalled as readahead tasks finish
+	uint64		next;		// where the last read ended
+	int			run;		// sequential reads seen in a row
+	uint64		queued;		// the last chunk handed to readahead
+	size_t		inflight;	// readahead tasks not yet finished
+
+	uint64		hit;
+	uint64		missed;
+
+	size_t		get(aes& schedule, const uint64 i, byte buf[], const size_t off, const size_t len);
+	bool		reserve(const uint64 i);
+	size_t		fill(aes& schedule, const uint64 i, byte buf[], const size_t off, const size_t len);
+	void		load(aes& schedule, const uint64 i, std::vector<byte>& data);
+	void		readahead(const uint64 pos, const size_t len);
+};
+
+#endif
@@ -0,0 +1,79 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawrekey.cpp                                 (file 23) |
+|********************************************************/
+
+#include "rawrekey.h"
+#include "rawstream.h"
+
+class rawrekey_worker : public rawtask
+{
+public:
+	rawrekey_worker(rawrekey& r) : rekey(r) {};
+	void	run(rawworker& w) { rekey.work(w); };
+
+private:
+	rawrekey&	rekey;
+};
+
+void rawrekey::run(rawfile& in, rawfile& out)
+{
+	off_t size = in.size();
+
+	if (size % rawfile::block != 0) throw "Input File Is Not Whole Blocks!";
+
+	src = &in;
+	dst = &out;
+	count = (size + rawfile::buffer - 1) / rawfile::buffer;
+	claimed = 0;
+	error = NULL;
+
+	out.preallocate(size);
+
+	for (size_t i = 0; i < pool.size(); ++i) pool.push(new rawrekey_worker(*this));
+	pool.wait();
+
+	if (error != NULL) throw error;
+
+	out.truncate(size);
+}
+
+void rawrekey::work(rawworker& w)
+{
+	byte*	buf = w.pool->buffers().get();
+	aes		fresh(renew);
+
+	rawstream	from(w.crypto, false);
+	rawstream	to(fresh, true);
+
+	while (error == NULL) {
+		uint64 i = __sync_fetch_and_add(&claimed, 1);
+		if (i >= count) break;
+
+		off_t	pos = i * rawfile::buffer;
+		size_t	len = (src->size() - pos < rawfile::buffer) ? src->size() - pos : static_cast<off_t>(rawfile::buffer);
+
+		try {
+			if (src->read_at(buf, len, pos) != len) throw "Input File Changed Size!";
+
+			from.crypt(buf, len);
+			to.crypt(buf, len);
+
+			dst->write_at(buf, len, pos);
+		} catch (const char* str) {
+			__sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), str);
+		}
+	}
+
+	w.pool->buffers().put(buf);
+}
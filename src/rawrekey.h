@@ -0,0 +1,54 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawrekey.h                                   (file 24) |
+|********************************************************/
+
+#if !defined(rawrekey_h)
+#define rawrekey_h
+
+#include <sys/types.h>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawpool.h"
+#include <be/support/SupportDefs.h>
+
+// rawrekey moves a plain rawaes file from the pool's key to another in one
+// pass.  Each worker takes rawfile::buffer bytes at a time, decrypts them
+// with the old key and encrypts them with the new in the same buffer, and
+// writes them back to the same place, so the plaintext never reaches the
+// disk.  The output may be the input itself, but a run cut short then
+// leaves it under neither key; rawaes writes a new copy and renames it
+// over the input instead.  Containers are rekeyed by rawcont.
+
+class rawrekey
+{
+public:
+	rawrekey(rawpool& workers, const aes& fresh) : pool(workers), renew(fresh), src(NULL),
+		dst(NULL), count(0), claimed(0), error(NULL) {};
+
+	void		run(rawfile& in, rawfile& out);
+	void		work(rawworker& w);
+
+private:
+	rawpool&	pool;
+	const aes&	renew;		// the new key schedule
+
+	rawfile*	src;
+	rawfile*	dst;
+	uint64		count;		// pieces in the file
+	uint64		claimed;
+	const char*	error;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawreorder.cpp                               (file 25) |
+|********************************************************/
+
+#include "rawreorder.h"
+
+rawreorder::rawreorder(rawfile& f, const off_t start, const size_t window, rawbuffers& p)
+	: out(&f), sum(NULL), pool(p), limit(window), writing(false), error(NULL), head(0),
+	pos(start), held(0)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&moved, NULL);
+
+	starts.push_back(start);
+}
+
+// The data is checksummed in order and then dropped, for checks that have
+// no need of the output itself.
+
+rawreorder::rawreorder(checksum& s, const size_t window, rawbuffers& p)
+	: out(NULL), sum(&s), pool(p), limit(window), writing(false), error(NULL), head(0),
+	pos(0), held(0)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&moved, NULL);
+
+	starts.push_back(0);
+}
+
+rawreorder::~rawreorder(void)
+{
+	std::map<uint64, std::deque<piece> >::iterator i;
+
+	for (i = queued.begin(); i != queued.end(); ++i)
+		for (size_t j = 0; j < i->second.size(); ++j)
+			if (i->second[j].buf != NULL) pool.put(i->second[j].buf);
+
+	pthread_cond_destroy(&moved);
+	pthread_mutex_destroy(&lock);
+}
+
+// Takes over buf, which must come from the pool given to the constructor.
+// Whichever thread finds the output idle writes every piece that is ready,
+// in order, including those handed over by other threads meanwhile.
+
+void rawreorder::put(const uint64 seq, byte* buf, const size_t len, const bool last)
+{
+	piece p;
+	p.buf = buf;
+	p.len = len;
+	p.last = last;
+
+	pthread_mutex_lock(&lock);
+
+	while (seq != head && held >= limit && error == NULL) pthread_cond_wait(&moved, &lock);
+
+	queued[seq].push_back(p);
+	++held;
+
+	if (writing) { pthread_mutex_unlock(&lock); return; }
+	writing = true;
+
+	for (;;) {
+		std::map<uint64, std::deque<piece> >::iterator i = queued.find(head);
+		if (i == queued.end() || i->second.empty()) break;
+
+		piece next = i->second.front();
+		i->second.pop_front();
+		if (i->second.empty()) queued.erase(i);
+		--held;
+
+		off_t at = pos;
+		pthread_mutex_unlock(&lock);
+
+		try {
+			if (next.len != 0 && error == NULL) {
+				if (sum != NULL) sum->update(next.buf, next.len);
+				if (out != NULL) out->write_at(next.buf, next.len, at);
+			}
+		} catch (const char* str) {
+			error = str;
+		}
+		if (next.buf != NULL) pool.put(next.buf);
+
+		pthread_mutex_lock(&lock);
+		pos += next.len;
+
+		if (next.last) {
+			++head;
+			starts.push_back(pos);
+		}
+
+		pthread_cond_broadcast(&moved);
+	}
+
+	writing = false;
+	const char* failed = error;
+	pthread_mutex_unlock(&lock);
+
+	if (failed != NULL) throw failed;
+}
+
+// Only meaningful once stream seq has been written completely.
+
+off_t rawreorder::offset(const uint64 seq) const
+{
+	return starts[seq];
+}
+
+off_t rawreorder::length(const uint64 seq) const
+{
+	return starts[seq + 1] - starts[seq];
+}
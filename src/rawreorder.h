@@ -0,0 +1,80 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawreorder.h                                 (file 26) |
+|********************************************************/
+
+#if !defined(rawreorder_h)
+#define rawreorder_h
+
+#include <deque>
+#include <map>
+#include <pthread.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawhash.h"
+#include <be/support/SupportDefs.h>
+
+// rawreorder lets several workers produce one sequential output.  Each
+// stream of data has a sequence number and is handed over in one or more
+// pieces, the last marked as such.  Pieces are written as soon as every
+// stream before theirs is complete, and held back until then; a worker
+// that gets too far ahead of the output waits for it to catch up.
+//
+// The worker producing the oldest unfinished stream never waits, so as long
+// as streams are started in sequence order the output always moves on.
+
+class rawreorder
+{
+public:
+	rawreorder(rawfile& f, const off_t start, const size_t window, rawbuffers& p);
+	rawreorder(checksum& s, const size_t window, rawbuffers& p);	// feeds s, writes nothing
+   ~rawreorder(void);
+
+	void		put(const uint64 seq, byte* buf, const size_t len, const bool last);
+
+	off_t		offset(const uint64 seq) const;		// where stream seq begins
+	off_t		length(const uint64 seq) const;		// bytes written for seq
+	off_t		end(void) const	{ return pos; };	// the first unwritten byte
+
+private:
+	rawreorder(const rawreorder&);
+	rawreorder&	operator=(const rawreorder&);
+
+	struct piece
+	{
+		byte*		buf;		// a pool buffer, or NULL for an empty piece
+		size_t		len;
+		bool		last;
+	};
+
+	rawfile*		out;		// NULL when the data only goes to sum
+	checksum*		sum;
+	rawbuffers&		pool;
+	size_t			limit;		// pieces held back before producers wait
+
+	pthread_mutex_t	lock;
+	pthread_cond_t	moved;		// signalled whenever the output advances
+	bool			writing;	// true while one thread writes for all
+	const char*		error;		// the first write failure
+	uint64			head;		// the oldest unfinished stream
+	off_t			pos;
+	size_t			held;
+
+	std::map<uint64, std::deque<piece> >	queued;
+	std::vector<off_t>						starts;	// offset of each stream
+};
+
+#endif
@@ -0,0 +1,287 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawshard.cpp                                 (file 27) |
+|********************************************************/
+
+#include "rawshard.h"
+#include "rawstream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+static const char	rawshard_magic[] = "rawaesM1";
+
+class rawshard_worker : public rawtask
+{
+public:
+	rawshard_worker(rawshard& s) : shards(s) {};
+	void	run(rawworker& w) { shards.work(w); };
+
+private:
+	rawshard&	shards;
+};
+
+bool rawshard::detect(const char* path)
+{
+	char	head[8];
+	FILE*	f = fopen(path, "rb");
+
+	if (f == NULL) return false;
+
+	bool found = fread(head, 1, 8, f) == 8 && memcmp(head, rawshard_magic, 8) == 0;
+
+	fclose(f);
+	return found;
+}
+
+static std::string hex_of(const byte buf[], const size_t len)
+{
+	static const char	digits[] = "0123456789abcdef";
+	std::string			s;
+
+	for (size_t i = 0; i < len; ++i) {
+		s += digits[buf[i] >> 4];
+		s += digits[buf[i] & 15];
+	}
+
+	return s;
+}
+
+static std::string key_check(aes& crypto)
+{
+	byte	zero[rawfile::block];
+	byte	check[rawfile::block];
+
+	memset(zero, 0, sizeof(zero));
+	crypto.encrypt(zero, check);
+
+	return hex_of(check, sizeof(check));
+}
+
+// Parts sit next to the manifest, named after it.
+
+static std::string folder_of(const char* manifest)
+{
+	const char* slash = strrchr(manifest, '/');
+
+	return (slash == NULL) ? std::string() : std::string(manifest, slash - manifest + 1);
+}
+
+static std::string base_of(const char* manifest)
+{
+	const char* slash = strrchr(manifest, '/');
+
+	return (slash == NULL) ? manifest : slash + 1;
+}
+
+uint64 rawshard::bytes(const uint64 k) const
+{
+	uint64 total = rawstream::padded(olen);
+
+	return (total - k * shard < shard) ? total - k * shard : shard;
+}
+
+// Encrypts in into parts of size bytes each, named after the manifest with
+// ".000", ".001" and so on added.  The manifest is written last, to a new
+// file that is synced and then replaces any old one, so it only ever lists
+// whole parts, even after a crash.
+
+void rawshard::split(rawfile& in, const char* manifest, const uint64 size)
+{
+	if (size == 0 || size % rawfile::block != 0) throw "Invalid Part Size!";
+
+	sealing = true;
+	olen = in.size();
+	shard = size;
+	whole = &in;
+
+	uint64		n = (rawstream::padded(olen) + shard - 1) / shard;
+	std::string	folder = folder_of(manifest);
+	std::string	base = base_of(manifest);
+	std::string	list;
+	char		line[64];
+
+	snprintf(line, sizeof(line), "%s\t%llu\t%llu\t%d\t", rawshard_magic,
+		static_cast<unsigned long long>(olen), static_cast<unsigned long long>(shard), key_bits);
+	list = line + key_check(crypto) + "\n";
+
+	names.clear();
+	for (uint64 k = 0; k < n; ++k) {
+		snprintf(line, sizeof(line), ".%03llu", static_cast<unsigned long long>(k));
+		std::string name = base + line;
+		names.push_back(folder + name);
+
+		snprintf(line, sizeof(line), "%llu", static_cast<unsigned long long>(bytes(k)));
+		list += name + "\t" + line + "\n";
+	}
+
+	run();
+
+	std::string	temp = std::string(manifest) + ".new";
+	rawfile		f;
+
+	unlink(temp.c_str());
+	if (f.open(temp.c_str(), rawfile::out) != B_OK) throw "Cannot Write Part Manifest!";
+
+	f.write_at(reinterpret_cast<const byte*>(list.data()), list.size(), 0);
+	f.truncate(list.size());
+	f.datasync();
+	f.unset();
+
+	if (rename(temp.c_str(), manifest) != 0) throw "Cannot Write Part Manifest!";
+	rawfile::sync_dir(manifest);
+}
+
+// Reads the manifest and checks every part is there and whole before any
+// of them is decrypted into out.
+
+void rawshard::join(const char* manifest, rawfile& out)
+{
+	FILE* f = fopen(manifest, "r");
+	if (f == NULL) throw "Cannot Read Part Manifest!";
+
+	std::vector<std::string>	lines;
+	std::string					line;
+	int							c;
+
+	do {
+		c = fgetc(f);
+
+		if (c != '\n' && c != EOF) { line += static_cast<char>(c); continue; }
+		if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+		if (!line.empty()) lines.push_back(line);
+
+		line.clear();
+	} while (c != EOF);
+
+	fclose(f);
+
+	char	check[40];
+	int		bits = 0;
+	unsigned long long	length = 0;
+	unsigned long long	size = 0;
+
+	if (lines.empty() || lines[0].compare(0, 9, std::string(rawshard_magic) + "\t") != 0
+		|| sscanf(lines[0].c_str() + 9, "%llu\t%llu\t%d\t%39s", &length, &size, &bits, check) != 4
+		|| size == 0 || size % rawfile::block != 0) throw "Part Manifest Is Damaged!";
+
+	if (bits != key_bits) throw "Parts Use a Different Key Size!";
+	if (key_check(crypto) != check) throw "Wrong Key for Parts!";
+
+	sealing = false;
+	olen = length;
+	shard = size;
+	whole = &out;
+
+	uint64		n = (rawstream::padded(olen) + shard - 1) / shard;
+	std::string	folder = folder_of(manifest);
+
+	if (lines.size() != n + 1) throw "Part Manifest Is Damaged!";
+
+	names.clear();
+	for (uint64 k = 0; k < n; ++k) {
+		std::string::size_type tab = lines[k + 1].rfind('\t');
+
+		if (tab == std::string::npos || tab == 0
+			|| strtoull(lines[k + 1].c_str() + tab + 1, NULL, 10) != bytes(k))
+			throw "Part Manifest Is Damaged!";
+
+		// parts sit next to the manifest; a name that reaches elsewhere
+		// is not one split wrote
+		std::string name = lines[k + 1].substr(0, tab);
+
+		if (name.find('/') != std::string::npos || name.find("..") != std::string::npos)
+			throw "Part Manifest Is Damaged!";
+
+		names.push_back(folder + name);
+
+		rawfile part;
+		if (part.open(names[k].c_str(), rawfile::in) != B_OK
+			|| static_cast<uint64>(part.size()) != bytes(k)) throw "A Part Is Missing or Damaged!";
+	}
+
+	out.preallocate(olen);
+
+	run();
+
+	out.truncate(olen);
+}
+
+void rawshard::run(void)
+{
+	claimed = 0;
+	error = NULL;
+
+	for (size_t i = 0; i < pool.size(); ++i) pool.push(new rawshard_worker(*this));
+	pool.wait();
+
+	whole = NULL;
+
+	if (error != NULL) throw error;
+}
+
+// A worker takes one part at a time and works through it from start to
+// end, so each part file is written in order by a single thread.
+
+void rawshard::work(rawworker& w)
+{
+	byte*		buf = w.pool->buffers().get();
+	rawstream	stream(w.crypto, sealing);
+
+	while (error == NULL) {
+		uint64 k = __sync_fetch_and_add(&claimed, 1);
+		if (k >= names.size()) break;
+
+		try {
+			rawfile	part;
+			uint64	start = k * shard;
+			uint64	total = bytes(k);
+
+			if (part.open(names[k].c_str(), sealing ? rawfile::out : rawfile::in, io) != B_OK)
+				throw sealing ? "Cannot Initialize Output File!" : "Cannot Initialize Input File!";
+
+			if (sealing) part.preallocate(total);
+
+			for (uint64 done = 0; done < total; done += rawfile::buffer) {
+				size_t	len = (total - done < rawfile::buffer) ? total - done : static_cast<uint64>(rawfile::buffer);
+				uint64	at = start + done;
+				size_t	plain = (olen - at < len) ? olen - at : len;
+
+				if (sealing) {
+					if (whole->read_at(buf, plain, at) != plain) throw "Input File Changed Size!";
+
+					memset(buf + plain, 0, len - plain);
+					stream.crypt(buf, len);
+					part.write_at(buf, len, done);
+				}
+				else {
+					if (part.read_at(buf, len, done) != len) throw "A Part Is Missing or Damaged!";
+
+					stream.crypt(buf, len);
+					whole->write_at(buf, plain, at);
+				}
+			}
+
+			if (sealing) {
+				part.truncate(total);
+				part.sync();
+			}
+		} catch (const char* str) {
+			__sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), str);
+		}
+	}
+
+	w.pool->buffers().put(buf);
+}
@@ -0,0 +1,78 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawshard.h                                   (file 28) |
+|********************************************************/
+
+#if !defined(rawshard_h)
+#define rawshard_h
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawpool.h"
+#include <be/support/SupportDefs.h>
+
+// rawshard writes the ciphertext of one file as a set of part files, each
+// holding a fixed number of bytes of it, so they can go to different disks
+// or be uploaded as the parts of one object.  Each part is written by its
+// own worker, straight from the input.  Cut at a multiple of the block
+// size, the parts are the plain rawaes file split up: each decrypts on its
+// own to its share of the input, and together they make the whole.
+//
+// A text manifest lists the parts, one per line, after a header line:
+//
+//   rawaesM1<TAB>original length<TAB>part size<TAB>key bits<TAB>check
+//   name<TAB>bytes
+//
+// The check is the encrypted zero block, in hex, to spot a wrong key.
+// Part names are relative to the directory holding the manifest, so the
+// set can be moved as a whole.  Decrypting the manifest decrypts every
+// part into place at once and restores the exact original length.
+
+class rawshard
+{
+public:
+	rawshard(aes& c, const int bits, rawpool& workers, const rawfile::policy& p)
+		: crypto(c), key_bits(bits), pool(workers), io(p), sealing(true), olen(0),
+		shard(0), whole(NULL), claimed(0), error(NULL) {};
+
+	static bool	detect(const char* path);
+
+	void		split(rawfile& in, const char* manifest, const uint64 size);
+	void		join(const char* manifest, rawfile& out);
+	void		work(rawworker& w);
+
+	uint64		parts(void) const	{ return names.size(); };
+
+private:
+	aes&		crypto;
+	int			key_bits;
+	rawpool&	pool;
+	rawfile::policy	io;		// how the parts are written and read
+
+	bool		sealing;	// true to split, false to join
+	uint64		olen;		// the original length
+	uint64		shard;		// ciphertext bytes in every part but the last
+	std::vector<std::string>	names;	// the path of each part
+	rawfile*	whole;		// the input when splitting, the output when joining
+	uint64		claimed;
+	const char*	error;
+
+	uint64		bytes(const uint64 k) const;
+	void		run(void);
+};
+
+#endif
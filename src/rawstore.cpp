@@ -0,0 +1,308 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawstore.cpp                                 (file 29) |
+|********************************************************/
+
+#include "rawstore.h"
+#include "rawstream.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char	rawstore_magic[] = "rawaesD1";
+static const char	rawstore_recipe[] = "rawaesR1";
+static const char	rawstore_label[] = "rawaes store key";
+
+rawstore::rawstore(aes& c, const int bits)
+	: crypto(c), key_bits(bits), lock(-1), chunks_end(0), index_end(0), total(0), fresh(0)
+{
+	// The hash table and the names both depend on the key, so neither the
+	// chunk lengths nor the names say anything to someone without it.
+	byte	count[rawfile::block];
+	byte	pad[rawfile::block];
+
+	memset(count, 0, sizeof(count));
+
+	for (int i = 0; i < 256; ++i) {
+		count[0] = static_cast<byte>(i);
+		count[1] = 1;
+		crypto.encrypt(count, pad);
+		gear[i] = uint64_in(pad);
+	}
+
+	crypto.encrypt(reinterpret_cast<const byte*>(rawstore_label), secret);
+}
+
+rawstore::~rawstore(void)
+{
+	if (lock >= 0) ::close(lock);
+}
+
+// The zero block encrypted under the key, to tell a wrong key from damage.
+
+void rawstore::check(const byte head[]) const
+{
+	byte	zero[rawfile::block];
+	byte	test[rawfile::block];
+
+	memset(zero, 0, sizeof(zero));
+	crypto.encrypt(zero, test);
+
+	if (memcmp(test, head, sizeof(test)) != 0) throw "Wrong Key for Chunk Store!";
+}
+
+void rawstore::open(const std::string& dir)
+{
+	if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) throw "Cannot Create Chunk Store!";
+
+	// another run adding to the store is waited for, not raced
+	if (lock < 0 && (lock = ::open(dir.c_str(), O_RDONLY)) < 0) throw "Cannot Open Chunk Store!";
+	if (flock(lock, LOCK_EX) != 0) throw "Cannot Lock Chunk Store!";
+
+	// the store is always synced, whatever the policy for the recipe
+	rawfile::policy	p;
+	p.durability = rawfile::file;
+
+	if (chunks.open((dir + "/chunks").c_str(), rawfile::update, p) != B_OK
+		&& chunks.open((dir + "/chunks").c_str(), rawfile::out, p) != B_OK) throw "Cannot Open Chunk Store!";
+	if (index.open((dir + "/index").c_str(), rawfile::update, p) != B_OK
+		&& index.open((dir + "/index").c_str(), rawfile::out, p) != B_OK) throw "Cannot Open Chunk Store!";
+
+	byte	head[header];
+
+	if (chunks.size() == 0) {
+		byte zero[rawfile::block];
+
+		memset(head, 0, sizeof(head));
+		memset(zero, 0, sizeof(zero));
+		memcpy(head, rawstore_magic, 8);
+		uint32_out(head + 8, version);
+		uint32_out(head + 12, key_bits);
+		crypto.encrypt(zero, head + 16);
+
+		chunks.write_at(head, header, 0);
+		index.truncate(0);
+	}
+	else if (chunks.read_at(head, header, 0) != header
+		|| memcmp(head, rawstore_magic, 8) != 0 || uint32_in(head + 8) != version)
+		throw "Not a rawaes Chunk Store!";
+	else if (static_cast<int>(uint32_in(head + 12)) != key_bits) throw "Chunk Store Uses a Different Key Size!";
+	else check(head + 16);
+
+	chunks_end = chunks.size();
+
+	// a record cut short, or one for a chunk that never got written, marks
+	// where an earlier run stopped; the index goes on from there
+	std::vector<byte> list(index.size() + 1);
+	size_t got = index.read_at(&list[0], index.size(), 0);
+	size_t n = got / record;
+
+	where.clear();
+	index_end = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		const byte* r = &list[i * record];
+		place p;
+
+		p.offset = uint64_in(r + 32);
+		p.length = uint32_in(r + 40);
+
+		if (p.offset < header || p.offset > chunks_end || p.length > chunks_end - p.offset) break;
+
+		where[std::string(reinterpret_cast<const char*>(r), sha256::size)] = p;
+		index_end += record;
+	}
+}
+
+// The length of the next chunk in buf; the whole of it if len is within
+// the largest chunk and the input ends there.
+
+size_t rawstore::cut(const byte buf[], const size_t len) const
+{
+	const uint64 mask = ((static_cast<uint64>(1) << cut_bits) - 1) << (64 - cut_bits);
+
+	if (len <= min_chunk) return len;
+
+	size_t	end = (len < max_chunk) ? len : static_cast<size_t>(max_chunk);
+	uint64	h = 0;
+
+	// each byte shifts the last out of the top of the hash after 64 more,
+	// so the top bits depend on the last 64 bytes only
+	for (size_t i = min_chunk; i < end; ++i) {
+		h = (h << 1) + gear[buf[i]];
+		if ((h & mask) == 0) return i + 1;
+	}
+
+	return end;
+}
+
+void rawstore::name(const byte buf[], const size_t len, byte id[]) const
+{
+	sha256 hash;
+
+	hash.update(secret, sizeof(secret));
+	hash.update(buf, len);
+	hash.final(id);
+}
+
+// Encrypts buf in place and appends it to the store.
+
+void rawstore::store(byte buf[], const size_t len, const byte id[])
+{
+	rawstream stream(crypto, true);
+	stream.ctr(id, 0, buf, len);
+
+	chunks.write_at(buf, len, chunks_end);
+
+	byte r[record];
+	memset(r, 0, sizeof(r));
+	memcpy(r, id, sha256::size);
+	uint64_out(r + 32, chunks_end);
+	uint32_out(r + 40, len);
+
+	index.write_at(r, record, index_end);
+
+	place p;
+	p.offset = chunks_end;
+	p.length = len;
+	where[std::string(reinterpret_cast<const char*>(id), sha256::size)] = p;
+
+	chunks_end += len;
+	index_end += record;
+}
+
+void rawstore::backup(rawfile& in, rawfile& recipe)
+{
+	std::vector<byte>	window(rawfile::buffer + max_chunk);
+	std::vector<byte>	part(max_chunk);
+	uint64				pos = 0;		// input read so far
+	size_t				held = 0;		// bytes waiting in window
+	byte				entry[recipe_entry];
+
+	total = 0;
+	fresh = 0;
+
+	for (;;) {
+		// keep at least one largest chunk in hand unless the input is done
+		if (held < max_chunk && pos < static_cast<uint64>(in.size())) {
+			size_t got = in.read_at(&window[held], window.size() - held, pos);
+
+			held += got;
+			pos += got;
+			if (got == 0) throw "Input File Changed Size!";
+		}
+
+		if (held == 0) break;
+
+		size_t	len = cut(&window[0], held);
+		byte	id[sha256::size];
+
+		name(&window[0], len, id);
+
+		if (where.find(std::string(reinterpret_cast<const char*>(id), sha256::size)) == where.end()) {
+			memcpy(&part[0], &window[0], len);
+			store(&part[0], len, id);
+			++fresh;
+		}
+
+		memset(entry, 0, sizeof(entry));
+		memcpy(entry, id, sha256::size);
+		uint32_out(entry + 32, len);
+		recipe.write_at(entry, recipe_entry, recipe_header + total * recipe_entry);
+
+		++total;
+
+		memmove(&window[0], &window[len], held - len);
+		held -= len;
+	}
+
+	// the chunks, then the entries naming them, then the recipe
+	if (fresh != 0) {
+		chunks.sync();
+		index.sync();
+	}
+
+	byte	head[recipe_header];
+	byte	zero[rawfile::block];
+
+	memset(head, 0, sizeof(head));
+	memset(zero, 0, sizeof(zero));
+	memcpy(head, rawstore_recipe, 8);
+	uint32_out(head + 8, version);
+	uint32_out(head + 12, key_bits);
+	uint64_out(head + 16, total);
+	uint64_out(head + 24, pos);
+	crypto.encrypt(zero, head + 32);
+
+	recipe.write_at(head, recipe_header, 0);
+	recipe.truncate(recipe_header + total * recipe_entry);
+}
+
+// Every chunk is named again once decrypted, so damage to the store, or a
+// recipe from another store, is caught rather than restored.
+
+void rawstore::restore(rawfile& recipe, rawfile& out)
+{
+	byte	head[recipe_header];
+
+	if (recipe.read_at(head, recipe_header, 0) != recipe_header
+		|| memcmp(head, rawstore_recipe, 8) != 0) throw "Not a rawaes Recipe!";
+	if (uint32_in(head + 8) != version) throw "Unsupported Recipe Version!";
+	if (static_cast<int>(uint32_in(head + 12)) != key_bits) throw "Recipe Uses a Different Key Size!";
+	check(head + 32);
+
+	uint64	n = uint64_in(head + 16);
+	uint64	length = uint64_in(head + 24);
+	uint64	pos = 0;
+
+	if (n > (static_cast<uint64>(recipe.size()) - recipe_header) / recipe_entry) throw "Recipe Is Damaged!";
+
+	std::vector<byte>	buf(max_chunk);
+	byte				entry[recipe_entry];
+	byte				id[sha256::size];
+
+	out.preallocate(length);
+
+	for (uint64 i = 0; i < n; ++i) {
+		if (recipe.read_at(entry, recipe_entry, recipe_header + i * recipe_entry) != recipe_entry)
+			throw "Recipe Is Damaged!";
+
+		std::map<std::string, place>::const_iterator p =
+			where.find(std::string(reinterpret_cast<const char*>(entry), sha256::size));
+
+		if (p == where.end()) throw "Chunk Missing From Store!";
+		if (p->second.length != uint32_in(entry + 32) || p->second.length > max_chunk)
+			throw "Chunk Store Is Damaged!";
+
+		size_t len = p->second.length;
+
+		if (chunks.read_at(&buf[0], len, p->second.offset) != len) throw "Chunk Store Is Damaged!";
+
+		rawstream stream(crypto, false);
+		stream.ctr(entry, 0, &buf[0], len);
+
+		name(&buf[0], len, id);
+		if (memcmp(id, entry, sha256::size) != 0) throw "Chunk Store Is Damaged!";
+
+		out.write_at(&buf[0], len, pos);
+		pos += len;
+	}
+
+	if (pos != length) throw "Recipe Is Damaged!";
+
+	out.truncate(length);
+}
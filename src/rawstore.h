@@ -0,0 +1,113 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawstore.h                                   (file 30) |
+|********************************************************/
+
+#if !defined(rawstore_h)
+#define rawstore_h
+
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawhash.h"
+#include <be/support/SupportDefs.h>
+
+// A chunk store keeps every distinct piece of many backups once.  Inputs
+// are cut where a rolling hash of the last few bytes hits a pattern, so a
+// boundary moves with the data around it and an insertion early in a file
+// changes only the chunks near it.  Each chunk is named by a keyed SHA-256
+// of its plaintext and stored, encrypted, only the first time it is seen.
+//
+// The store is a directory of two files.  Every number is little endian.
+//
+//   chunks    header 48 bytes:  "rawaesD1", version (4), key bits (4),
+//             the encrypted zero block (16), reserved (16); then the
+//             ciphertext of each chunk, back to back
+//   index     48 bytes per chunk: name (32), offset in chunks (8),
+//             length (4), reserved (4)
+//
+// A backup of one file is a recipe listing its chunks in order:
+//
+//   header    64 bytes:  "rawaesR1", version (4), key bits (4),
+//                        chunk count (8), original length (8),
+//                        the encrypted zero block (16), reserved (16)
+//   entries   40 bytes per chunk: name (32), length (4), reserved (4)
+//
+// A chunk is encrypted in counter mode with its name as the nonce, so like
+// chunks give like ciphertext however often they are stored.  Chunks are
+// written before their index entries; entries for chunks that never made
+// it to disk are ignored when the store is opened.  A backup syncs the
+// chunks and then the index before it finishes its recipe, so a recipe on
+// disk never names a chunk that is not.  The store directory is locked
+// while it is open, so only one run at a time adds to it.
+
+class rawstore
+{
+public:
+	enum rawstore_const	{	header = 48,
+							record = 48,
+							recipe_header = 64,
+							recipe_entry = 40,
+							version = 1,
+							min_chunk = 16 << 10,
+							max_chunk = 256 << 10,
+							cut_bits = 16		// chunks average about 2^16 bytes past the minimum
+						};
+
+	rawstore(aes& c, const int bits);
+   ~rawstore(void);
+
+	void		open(const std::string& dir);
+	void		backup(rawfile& in, rawfile& recipe);
+	void		restore(rawfile& recipe, rawfile& out);
+
+	uint64		seen(void) const	{ return total; };		// chunks in the last backup
+	uint64		added(void) const	{ return fresh; };		// of those, new to the store
+
+private:
+	rawstore(const rawstore&);
+	rawstore&	operator=(const rawstore&);
+
+	struct place
+	{
+		uint64		offset;
+		uint32		length;
+	};
+
+	aes&		crypto;
+	int			key_bits;
+	uint64		gear[256];		// the rolling hash table, derived from the key
+	byte		secret[rawfile::block];	// keys the chunk names
+
+	int			lock;		// the store directory, locked, or -1
+	rawfile		chunks;
+	rawfile		index;
+	uint64		chunks_end;
+	uint64		index_end;
+
+	std::map<std::string, place>	where;
+
+	uint64		total;
+	uint64		fresh;
+
+	size_t		cut(const byte buf[], const size_t len) const;
+	void		name(const byte buf[], const size_t len, byte id[]) const;
+	void		store(byte buf[], const size_t len, const byte id[]);
+	void		check(const byte head[]) const;
+};
+
+#endif
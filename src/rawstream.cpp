@@ -0,0 +1,135 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawstream.cpp                                (file 31) |
+|********************************************************/
+
+#include "rawstream.h"
+
+#include <cstring>
+#include <vector>
+
+// Processes the whole of fin into fout, reserving the output first and
+// cutting it to its exact padded length at the end.
+
+void rawstream::run(rawfile& fin, rawfile& fout, rawbuffers& pool)
+{
+	off_t	fin_size = fin.size();
+	off_t	fout_size = padded(fin_size);
+
+	fout.preallocate(fout_size);
+
+	byte*	buf = pool.get();
+
+	try {
+		range(fin, fout, buf, 0, fin_size);
+	} catch (...) {
+		pool.put(buf);
+		throw;
+	}
+
+	pool.put(buf);
+
+	fout.truncate(fout_size);
+}
+
+// Processes len bytes of fin starting at pos, which must be a multiple of
+// the block size, into the same position of fout.  A range that ends
+// mid-block is padded with 0s.  Checksums are only meaningful when the
+// ranges of a file are processed in order.
+
+void rawstream::range(rawfile& fin, rawfile& fout, byte buf[], const off_t pos, const off_t len)
+{
+	off_t		offset = 0;
+	checksum*	before = enc ? plain_sum : cipher_sum;
+	checksum*	after = enc ? cipher_sum : plain_sum;
+
+	while (offset < len) {
+		size_t	rsize = rawfile::buffer;
+		if (len - offset < static_cast<off_t>(rsize)) rsize = len - offset;
+
+		size_t	psize = padded(rsize);
+		size_t	got = fin.read_at(buf, rsize, pos + offset);
+		for (size_t i = got; i < psize; ++i) *(buf + i) = 0;
+
+		// the checksums see each buffer while it is still in the cache
+		if (before != NULL) before->update(buf, rsize);
+		crypt(buf, psize);
+		if (after != NULL) after->update(buf, psize);
+
+		fout.write_at(buf, psize, pos + offset);
+
+		offset += rsize;
+		done += rsize;
+	}
+}
+
+// Overwrites the plaintext at pos in an ECB file with len bytes of buf.
+// Only the blocks the bytes fall in are read, decrypted, changed and
+// encrypted again; they must all lie within f.
+
+void rawstream::patch(rawfile& f, const byte buf[], const size_t len, const uint64 pos)
+{
+	uint64	lo = pos & ~static_cast<uint64>(rawfile::block - 1);
+	uint64	hi = padded(pos + len);
+
+	if (len == 0) return;
+	if (hi > static_cast<uint64>(f.size())) throw "Update Runs Past the End of the File!";
+
+	std::vector<byte>	blocks(hi - lo);
+
+	if (f.read_at(&blocks[0], blocks.size(), lo) != blocks.size()) throw "Cannot Read Input File!";
+
+	for (size_t i = 0; i < blocks.size(); i += rawfile::block) crypto.decrypt(&blocks[i], &blocks[i]);
+	memcpy(&blocks[pos - lo], buf, len);
+	for (size_t i = 0; i < blocks.size(); i += rawfile::block) crypto.encrypt(&blocks[i], &blocks[i]);
+
+	f.write_at(&blocks[0], blocks.size(), lo);
+
+	done += len;
+}
+
+// len must be a multiple of the block size
+
+void rawstream::crypt(byte buf[], const size_t len)
+{
+	if (enc) for (size_t i = 0; i < len; i += rawfile::block) crypto.encrypt(buf + i, buf + i);
+	else for (size_t i = 0; i < len; i += rawfile::block) crypto.decrypt(buf + i, buf + i);
+}
+
+// Counter mode: block n of the stream is XORed with the encryption of the
+// nonce plus n, so any block can be processed on its own and the last one
+// needs no padding.  Encrypting and decrypting are the same operation.
+
+void rawstream::ctr(const byte nonce[], const uint64 block, byte buf[], const size_t len)
+{
+	byte	count[rawfile::block];
+	byte	pad[rawfile::block];
+	uint64	base = 0;
+
+	for (int j = 8; j < 16; ++j) base = (base << 8) | nonce[j];
+	for (int j = 0; j < 8; ++j) count[j] = nonce[j];
+
+	base += block;
+
+	for (size_t i = 0; i < len; i += rawfile::block, ++base) {
+		uint64 low = base;
+		for (int j = 15; j >= 8; --j, low >>= 8) count[j] = static_cast<byte>(low);
+
+		crypto.encrypt(count, pad);
+
+		size_t end = (len - i < rawfile::block) ? len - i : static_cast<size_t>(rawfile::block);
+		for (size_t j = 0; j < end; ++j) buf[i + j] ^= pad[j];
+	}
+
+	done += len;
+}
@@ -0,0 +1,58 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawstream.h                                  (file 32) |
+|********************************************************/
+
+#if !defined(rawstream_h)
+#define rawstream_h
+
+#include <sys/types.h>
+
+#include "aes.h"
+#include "rawfile.h"
+#include "rawhash.h"
+#include <be/support/SupportDefs.h>
+
+// rawstream is the encrypt or decrypt pass over one file.  All offsets and
+// counts are off_t or uint64 so that inputs of many terabytes are handled
+// exactly; only the position inside a single buffer is a size_t.
+
+class rawstream
+{
+public:
+	rawstream(aes& c, const bool e) : crypto(c), enc(e), done(0),
+		plain_sum(NULL), cipher_sum(NULL) {};
+
+	static off_t	padded(const off_t len)	// output length for len input bytes
+					{ return (len + rawfile::block - 1) & ~static_cast<off_t>(rawfile::block - 1); };
+
+	void		run(rawfile& fin, rawfile& fout, rawbuffers& pool);
+	void		range(rawfile& fin, rawfile& fout, byte buf[], const off_t pos, const off_t len);
+	void		patch(rawfile& f, const byte buf[], const size_t len, const uint64 pos);
+	void		crypt(byte buf[], const size_t len);
+	void		ctr(const byte nonce[], const uint64 block, byte buf[], const size_t len);
+
+	uint64		processed(void) const	{ return done; };
+
+	// checksums fed by run() as each buffer passes, either may be NULL
+	void		sums(checksum* plain, checksum* cipher)	{ plain_sum = plain; cipher_sum = cipher; };
+
+private:
+	aes&		crypto;		// the caller's expanded key schedule
+	bool		enc;		// true to encrypt, false to decrypt
+	uint64		done;		// input bytes processed so far
+	checksum*	plain_sum;
+	checksum*	cipher_sum;
+};
+
+#endif
@@ -0,0 +1,250 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawtree.cpp                                  (file 33) |
+|********************************************************/
+
+#include "rawtree.h"
+#include "rawjob.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#endif
+
+// Scanning a directory is a task of its own, as is encrypting a file.
+
+class rawtree_scan : public rawtask
+{
+public:
+	rawtree_scan(rawtree& t, const std::string& i, const std::string& o) : tree(t), in(i), out(o) {};
+	void	run(rawworker&) { tree.scan(in, out); };
+
+private:
+	rawtree&	tree;
+	std::string	in;
+	std::string	out;
+};
+
+class rawtree_file : public rawtask
+{
+public:
+	rawtree_file(rawtree& t, const std::string& i, const std::string& o, const struct stat& s)
+		: tree(t), in(i), out(o), st(s) {};
+	void	run(rawworker& w) { tree.file(w, in, out, st); };
+
+private:
+	rawtree&	tree;
+	std::string	in;
+	std::string	out;
+	struct stat	st;
+};
+
+// Reads the names in a directory.  On Linux getdents64 fetches them in
+// large batches straight from the kernel; elsewhere readdir is used.
+
+static void list_dir(const int dfd, std::vector<std::string>& names)
+{
+#if defined(__linux__) && defined(SYS_getdents64)
+	struct linux_dirent64 {
+		uint64			d_ino;
+		int64			d_off;
+		unsigned short	d_reclen;
+		unsigned char	d_type;
+		char			d_name[1];
+	};
+
+	static const size_t	size = 64 * 1024;
+	std::vector<char>	buf(size);
+
+	for (;;) {
+		long n = syscall(SYS_getdents64, dfd, &buf[0], size);
+
+		if (n < 0) throw "Cannot Read Directory!";
+		if (n == 0) break;
+
+		for (long pos = 0; pos < n; ) {
+			linux_dirent64* d = reinterpret_cast<linux_dirent64*>(&buf[pos]);
+
+			names.push_back(d->d_name);
+			pos += d->d_reclen;
+		}
+	}
+#else
+	int dup_fd = dup(dfd);
+	DIR* d = (dup_fd < 0) ? NULL : fdopendir(dup_fd);
+	if (d == NULL) throw "Cannot Read Directory!";
+
+	struct dirent* e;
+	while ((e = readdir(d)) != NULL) names.push_back(e->d_name);
+
+	closedir(d);
+#endif
+}
+
+// Looks an entry up relative to its directory.  statx is asked only for the
+// fields rawtree uses, which saves work on filesystems that compute the
+// rest on demand.
+
+static int tree_stat(const int dfd, const char* name, struct stat& st)
+{
+#if defined(STATX_BASIC_STATS)
+	struct statx sx;
+
+	if (statx(dfd, name, AT_SYMLINK_NOFOLLOW,
+		STATX_TYPE|STATX_MODE|STATX_INO|STATX_SIZE|STATX_ATIME|STATX_MTIME, &sx) != 0)
+		return -1;
+
+	memset(&st, 0, sizeof(st));
+	st.st_mode = sx.stx_mode;
+	st.st_ino = sx.stx_ino;
+	st.st_dev = makedev(sx.stx_dev_major, sx.stx_dev_minor);
+	st.st_size = sx.stx_size;
+	st.st_atim.tv_sec = sx.stx_atime.tv_sec;
+	st.st_atim.tv_nsec = sx.stx_atime.tv_nsec;
+	st.st_mtim.tv_sec = sx.stx_mtime.tv_sec;
+	st.st_mtim.tv_nsec = sx.stx_mtime.tv_nsec;
+	return 0;
+#else
+	return fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW);
+#endif
+}
+
+rawtree::rawtree(rawpool& p, const rawfile::policy& f, const bool e)
+	: pool(p), io(f), enc(e), out_dev(0), out_ino(0)
+{
+	pthread_mutex_init(&lock, NULL);
+}
+
+rawtree::~rawtree(void)
+{
+	pthread_mutex_destroy(&lock);
+}
+
+bool rawtree::deeper(const dir& a, const dir& b)
+{
+	return std::count(a.path.begin(), a.path.end(), '/') > std::count(b.path.begin(), b.path.end(), '/');
+}
+
+void rawtree::run(const std::string& in, const std::string& out)
+{
+	struct stat st;
+
+	if (stat(in.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) throw "Input Must Be a Directory!";
+
+	mirror(out, st);
+
+	struct stat ost;
+	if (stat(out.c_str(), &ost) != 0) throw "Cannot Create Output Directory!";
+
+	out_dev = ost.st_dev;
+	out_ino = ost.st_ino;
+
+	pool.push(new rawtree_scan(*this, in, out));
+	pool.wait();
+
+	// writing into a directory changes its times, so they are set last,
+	// deepest first, once nothing more will be written below them
+	std::stable_sort(dirs.begin(), dirs.end(), deeper);
+
+	for (size_t i = 0; i < dirs.size(); ++i) {
+		const dir& d = dirs[i];
+		struct timespec times[2] = { d.st.st_atim, d.st.st_mtim };
+
+		if (chmod(d.path.c_str(), d.st.st_mode & 07777) != 0
+			|| utimensat(AT_FDCWD, d.path.c_str(), times, 0) != 0)
+			pool.fail(d.path, "Cannot Set Directory Attributes!");
+	}
+}
+
+// Output directories are created owner-writable and given their real mode
+// at the end, so that a read-only source directory can still be filled.
+
+void rawtree::mirror(const std::string& out, const struct stat& st)
+{
+	if (mkdir(out.c_str(), 0700) != 0 && errno != EEXIST) throw "Cannot Create Output Directory!";
+
+	dir d;
+	d.path = out;
+	d.st = st;
+
+	pthread_mutex_lock(&lock);
+	dirs.push_back(d);
+	pthread_mutex_unlock(&lock);
+}
+
+void rawtree::scan(const std::string& in, const std::string& out)
+{
+	int dfd = open(in.c_str(), O_RDONLY|O_DIRECTORY);
+	if (dfd < 0) { pool.fail(in, "Cannot Open Directory!"); return; }
+
+	std::vector<std::string> names;
+
+	try {
+		list_dir(dfd, names);
+	} catch (const char* str) {
+		close(dfd);
+		pool.fail(in, str);
+		return;
+	}
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		const std::string& name = names[i];
+		if (name == "." || name == "..") continue;
+
+		std::string	ipath = in + "/" + name;
+		std::string	opath = out + "/" + name;
+		struct stat	st;
+
+		try {
+			if (tree_stat(dfd, name.c_str(), st) != 0) throw "Cannot Read File Attributes!";
+
+			if (S_ISDIR(st.st_mode)) {
+				if (st.st_dev == out_dev && st.st_ino == out_ino) continue;
+
+				mirror(opath, st);
+				pool.push(new rawtree_scan(*this, ipath, opath));
+			}
+			else if (S_ISREG(st.st_mode)) {
+				pool.push(new rawtree_file(*this, ipath, opath, st));
+			}
+			else if (S_ISLNK(st.st_mode)) {
+				std::vector<char> target(st.st_size + 1);
+				ssize_t n = readlinkat(dfd, name.c_str(), &target[0], target.size());
+				if (n < 0 || n >= static_cast<ssize_t>(target.size())) throw "Cannot Read Link!";
+				target[n] = 0;
+
+				if (symlink(&target[0], opath.c_str()) != 0 && errno != EEXIST) throw "Cannot Create Link!";
+
+				struct timespec times[2] = { st.st_atim, st.st_mtim };
+				utimensat(AT_FDCWD, opath.c_str(), times, AT_SYMLINK_NOFOLLOW);
+			}
+			// devices, pipes and sockets have no contents to encrypt
+		} catch (const char* str) {
+			pool.fail(ipath, str);
+		}
+	}
+
+	close(dfd);
+}
+
+void rawtree::file(rawworker& w, const std::string& in, const std::string& out, const struct stat& st)
+{
+	rawjob::start(w, in, out, io, enc, &st);
+}
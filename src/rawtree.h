@@ -0,0 +1,70 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawtree.h                                    (file 34) |
+|********************************************************/
+
+#if !defined(rawtree_h)
+#define rawtree_h
+
+#include <pthread.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "rawfile.h"
+#include "rawpool.h"
+
+// rawtree mirrors a directory tree, encrypting or decrypting every regular
+// file into the same place in the output tree.  Directories are scanned
+// as pool tasks, so the walk runs in parallel with itself and with the
+// file tasks it produces.  Permissions and timestamps of files and
+// directories are carried over; symbolic links are copied as they are.
+
+class rawtree
+{
+public:
+	rawtree(rawpool& p, const rawfile::policy& f, const bool e);
+   ~rawtree(void);
+
+	void		run(const std::string& in, const std::string& out);
+
+	void		scan(const std::string& in, const std::string& out);
+	void		file(rawworker& w, const std::string& in, const std::string& out,
+					const struct stat& st);
+
+private:
+	rawtree(const rawtree&);
+	rawtree&	operator=(const rawtree&);
+
+	struct dir						// a directory whose attributes are set last
+	{
+		std::string		path;
+		struct stat		st;
+	};
+
+	rawpool&			pool;
+	rawfile::policy		io;
+	bool				enc;
+
+	dev_t				out_dev;	// the output root, never walked into
+	ino_t				out_ino;
+
+	pthread_mutex_t		lock;
+	std::vector<dir>	dirs;
+
+	void		mirror(const std::string& out, const struct stat& st);
+	static bool	deeper(const dir& a, const dir& b);
+};
+
+#endif
@@ -0,0 +1,135 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawverify.cpp                                (file 35) |
+|********************************************************/
+
+#include "rawverify.h"
+#include "rawstream.h"
+
+#include <cstring>
+
+class rawverify_worker : public rawtask
+{
+public:
+	rawverify_worker(rawverify& v) : verify(v) {};
+	void	run(rawworker& w) { verify.work(w); };
+
+private:
+	rawverify&	verify;
+};
+
+void rawverify::run(rawfile& in, rawcont* c, rawfile* against, checksum* sum)
+{
+	cont = c;
+	src = &in;
+	ref = against;
+	length = (cont != NULL) ? cont->length() : in.size();
+	piece = (cont != NULL) ? cont->chunk() : static_cast<uint64>(rawfile::buffer);
+	count = (length + piece - 1) / piece;
+	claimed = 0;
+	error = NULL;
+
+	if (cont == NULL && length % rawfile::block != 0) throw "Input File Is Not Whole Blocks!";
+
+	if (ref != NULL) {
+		uint64 rlen = ref->size();
+
+		if (cont != NULL ? rlen != length : rawstream::padded(rlen) != static_cast<off_t>(length))
+			throw "Verification Failed: Reference File Has Another Length!";
+	}
+
+	rawreorder* feed = (sum != NULL) ? new rawreorder(*sum, window, pool.buffers()) : NULL;
+	order = feed;
+
+	for (size_t i = 0; i < pool.size(); ++i) pool.push(new rawverify_worker(*this));
+	pool.wait();
+
+	order = NULL;
+	delete feed;
+
+	if (error != NULL) throw error;
+}
+
+void rawverify::work(rawworker& w)
+{
+	rawbuffers& buffers = w.pool->buffers();
+	byte* buf = buffers.get();
+
+	while (error == NULL) {
+		uint64 i = __sync_fetch_and_add(&claimed, 1);
+		if (i >= count) break;
+
+		bool given = false;
+
+		try {
+			size_t len = decrypt(w.crypto, i, buf);
+
+			if (ref != NULL) compare(i, buf, len, buffers);
+
+			// the buffer goes with the piece, so take another
+			if (order != NULL) {
+				byte* full = buf;
+
+				buf = buffers.get();
+				given = true;
+				order->put(i, full, len, true);
+			}
+		} catch (const char* str) {
+			__sync_bool_compare_and_swap(&error, static_cast<const char*>(NULL), str);
+
+			// later pieces may be waiting on this one
+			if (order != NULL && !given) {
+				try { order->put(i, NULL, 0, true); } catch (const char*) {}
+			}
+		}
+	}
+
+	buffers.put(buf);
+}
+
+size_t rawverify::decrypt(aes& schedule, const uint64 i, byte buf[])
+{
+	if (cont != NULL) return cont->read_chunk(schedule, *src, i, buf);
+
+	size_t len = (length - i * piece < piece) ? length - i * piece : piece;
+
+	if (src->read_at(buf, len, i * piece) != len) throw "Input File Changed Size!";
+
+	rawstream stream(schedule, false);
+	stream.crypt(buf, len);
+
+	return len;
+}
+
+void rawverify::compare(const uint64 i, const byte buf[], const size_t len, rawbuffers& buffers)
+{
+	uint64	at = i * piece;
+	uint64	rlen = ref->size();
+	size_t	want = (at >= rlen) ? 0 : (rlen - at < len) ? rlen - at : len;
+	byte*	mine = buffers.get();
+	bool	same = true;
+
+	try {
+		if (want != 0 && ref->read_at(mine, want, at) != want) throw "Cannot Read Reference File!";
+	} catch (...) {
+		buffers.put(mine);
+		throw;
+	}
+
+	same = (want == 0 || memcmp(mine, buf, want) == 0);
+	for (size_t j = want; j < len && same; ++j) same = (buf[j] == 0);
+
+	buffers.put(mine);
+
+	if (!same) throw "Verification Failed: Plaintext Differs From Reference File!";
+}
@@ -0,0 +1,70 @@
+/********************************************************|
+|  rawaes 1.1 for BeOS (Matthew Badger, (c) 2000)        |
+|  Encrypts files using the Advanced Encryption Standard |
+|--------------------------------------------------------|
+|  Makes use of code written by Dr. B. R. Gladman; this  |
+|  code can be found in the sub directory "aes".         |
+|--------------------------------------------------------|
+|  This program may be freely compiled and distributed,  |
+|  if and only if the program's source is also           |
+|  distributed. The author assumes no responsibility     |
+|  for damaged caused due to the use of this program.    |
+|--------------------------------------------------------|
+| rawverify.h                                  (file 36) |
+|********************************************************/
+
+#if !defined(rawverify_h)
+#define rawverify_h
+
+#include <sys/types.h>
+
+#include "aes.h"
+#include "rawcont.h"
+#include "rawfile.h"
+#include "rawhash.h"
+#include "rawpool.h"
+#include "rawreorder.h"
+#include <be/support/SupportDefs.h>
+
+// rawverify decrypts a container or a plain rawaes file and checks the
+// plaintext without writing it anywhere.  The workers take pieces of the
+// file in turn, a container's chunks or rawfile::buffer bytes of a plain
+// file, and decrypt each into a pool buffer.  A container's chunks are
+// checked against its hash tree as they are read; each piece may also be
+// compared with the same part of a reference file, and fed, in order, to
+// a checksum.  The first difference found stops the run.
+//
+// A plain rawaes file does not record its length, so its plaintext is
+// taken to run to the end of the last block, padding and all, as -d would
+// write it; a reference file must match it up to its own length and the
+// rest must be the 0s of the padding.
+
+class rawverify
+{
+public:
+	enum rawverify_const	{	window = 64		};	// pieces held for the checksum
+
+	rawverify(rawpool& workers) : pool(workers), cont(NULL), src(NULL), ref(NULL),
+		order(NULL), length(0), piece(rawfile::buffer), count(0), claimed(0), error(NULL) {};
+
+	void		run(rawfile& in, rawcont* c, rawfile* against, checksum* sum);
+	void		work(rawworker& w);
+
+private:
+	rawpool&	pool;
+
+	rawcont*	cont;		// NULL for a plain rawaes file
+	rawfile*	src;
+	rawfile*	ref;		// the reference file, if any
+	rawreorder*	order;		// puts the pieces in order for the checksum
+	uint64		length;		// plaintext bytes to check
+	uint64		piece;		// plaintext bytes per piece
+	uint64		count;
+	uint64		claimed;
+	const char*	error;
+
+	size_t		decrypt(aes& schedule, const uint64 i, byte buf[]);
+	void		compare(const uint64 i, const byte buf[], const size_t len, rawbuffers& buffers);
+};
+
+#endif
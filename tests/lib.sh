@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# Helpers sourced by the tests.
+
+# the n bytes at pos in file, as decimal numbers
+bytes()
+{
+	od -An -tu1 -j "$2" -N "$3" "$1" | tr -s ' \n' '  '
+}
+
+# XOR of the bytes at pos in two files
+xored()
+{
+	set -- $(bytes "$1" "$3" "$4") / $(bytes "$2" "$3" "$4")
+	n=$(( ($# - 1) / 2 ))
+	out=""
+	i=1
+	while [ $i -le $n ]; do
+		eval "a=\${$i} b=\${$((i + n + 1))}"
+		out="$out $((a ^ b))"
+		i=$((i + 1))
+	done
+	echo $out
+}
+
+# flips the low bit of the byte at pos in file
+flip()
+{
+	b=$(bytes "$1" "$2" 1)
+	printf "$(printf '\\%03o' $((b ^ 1)))" | dd of="$1" bs=1 seek="$2" conv=notrunc 2>/dev/null
+}
+
+# the little endian 64-bit number at pos in file
+le64()
+{
+	set -- $(bytes "$1" "$2" 8)
+	echo $(( $1 | $2 << 8 | $3 << 16 | $4 << 24 | $5 << 32 | $6 << 40 | $7 << 48 | $8 << 56 ))
+}
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Runs every tests/t_*.sh against a built rawaes.
+#
+#   usage: sh tests/run.sh path/to/rawaes [scratch_dir]
+#
+# Each test gets RAWAES, the binary, TESTS, this directory, and SCRATCH, an
+# empty directory of its own under scratch_dir (default /tmp), which is
+# removed if it passes.  A test fails by exiting non-zero.  The large file
+# tests need about 12 GB of free space in scratch_dir, most of it in holes.
+
+if [ $# -lt 1 ]; then
+	echo "usage: sh tests/run.sh path/to/rawaes [scratch_dir]" >&2
+	exit 2
+fi
+
+RAWAES=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+TESTS=$(cd "$(dirname "$0")" && pwd)
+ROOT=${2:-/tmp}/rawaes-tests.$$
+failed=0
+
+export RAWAES TESTS
+
+for t in "$TESTS"/t_*.sh; do
+	name=$(basename "$t" .sh)
+	SCRATCH=$ROOT/$name
+	export SCRATCH
+
+	mkdir -p "$SCRATCH"
+
+	if (cd "$SCRATCH" && sh "$t") > "$ROOT/$name.log" 2>&1; then
+		echo "PASS $name"
+		rm -rf "$SCRATCH" "$ROOT/$name.log"
+	else
+		echo "FAIL $name (see $ROOT/$name.log)"
+		failed=1
+	fi
+done
+
+[ $failed -eq 0 ] && rm -rf "$ROOT"
+exit $failed
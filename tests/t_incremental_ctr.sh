@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# A chunk that --incremental rewrites in CTR mode is encrypted under a new
+# keystream: XORing its old and new ciphertext must not give the XOR of the
+# old and new plaintext.  Chunks that did not change are left as they were.
+
+set -e
+
+CHUNK=1048576
+DATA=$((96 + CHUNK + 32 + 32))		# chunk 1's stored bytes
+AT=2000000
+
+. "$TESTS/lib.sh"
+
+head -c $((3 * CHUNK + 5000)) /dev/urandom > in
+"$RAWAES" --incremental -e k1 in c.enc
+cp in old.in
+cp c.enc old.enc
+
+printf 'WXYZ' | dd of=in bs=1 seek=$AT conv=notrunc 2>/dev/null
+"$RAWAES" --incremental -e k1 in c.enc
+
+"$RAWAES" -d k1 c.enc back
+cmp in back
+
+plain=$(xored old.in in $AT 4)
+cipher=$(xored old.enc c.enc $((DATA + AT - CHUNK)) 4)
+[ "$plain" != "$cipher" ]
+
+# the whole chunk is under a new keystream, not just the bytes that changed
+[ "$(cmp -l -i $DATA -n $CHUNK old.enc c.enc | wc -l)" -gt 1000 ]
+
+# chunk 0, after the header, was not touched
+cmp -i 96 -n $((32 + CHUNK)) old.enc c.enc
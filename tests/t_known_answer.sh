@@ -0,0 +1,16 @@
+#!/bin/sh
+#
+# One block under a 128-bit key, checked against the answer any other AES
+# gives, and a plain round trip.  Catches an AES word that is not 32 bits.
+
+set -e
+
+printf '0123456789abcdef' > in
+"$RAWAES" -e "YELLOW SUBMARINE" in out
+
+[ "$(od -An -tx1 out | tr -d ' \n')" = "201e802f7b6ace6f6cd0a743ba78aead" ]
+
+head -c 100003 /dev/urandom > in
+"$RAWAES" -e somekey in out
+"$RAWAES" -d somekey out back
+cmp -n 100003 in back
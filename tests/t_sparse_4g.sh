@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# A sparse input of just over 5 GiB, with data before 4 GiB, across it and
+# well past it, round trips as a plain rawaes file and as a container, and
+# --offset past 4 GiB decrypts the right bytes from either.
+
+set -e
+
+G=4294967296
+SIZE=$((5 * G + 7))
+OFF=$((G + 123456789))
+LEN=3000000
+
+head -c 1048576 /dev/urandom > seed
+
+truncate -s $SIZE in
+dd if=seed of=in bs=1048576 conv=notrunc 2>/dev/null
+dd if=seed of=in bs=1 seek=$((G - 8)) count=65536 conv=notrunc 2>/dev/null
+dd if=seed of=in bs=1048576 seek=$((OFF / 1048576)) conv=notrunc 2>/dev/null
+dd if=seed of=in bs=1 seek=$((SIZE - 1000)) count=1000 conv=notrunc 2>/dev/null
+
+tail -c +$((OFF + 1)) in | head -c $LEN > want
+
+# plain rawaes, padded to a whole block
+"$RAWAES" -e k1 in p.enc
+[ "$(wc -c < p.enc)" -eq $((SIZE + 9)) ]
+
+"$RAWAES" -d k1 --offset=$OFF --length=$LEN p.enc part
+cmp want part
+
+"$RAWAES" -d k1 p.enc p.dec
+rm p.enc
+cmp -n $SIZE in p.dec
+rm p.dec
+
+# container, holes and all
+"$RAWAES" --container -e k1 in c.enc
+
+"$RAWAES" -d k1 --offset=$OFF --length=$LEN c.enc part
+cmp want part
+
+"$RAWAES" -d k1 c.enc c.dec
+cmp in c.dec
@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# A container with one bit changed in its header, a chunk or its tree fails
+# both --verify and -d, whatever the bit: the root tag covers the header,
+# and every chunk is checked against the tree as it is read.
+
+set -e
+
+CHUNK=1048576
+
+. "$TESTS/lib.sh"
+
+fails()
+{
+	if "$@" > /dev/null 2>&1; then
+		echo "should have failed: $*"
+		exit 1
+	fi
+}
+
+head -c $((3 * CHUNK + 5000)) /dev/urandom > in
+"$RAWAES" --container -e k1 in c.enc
+"$RAWAES" --verify -d k1 c.enc
+
+SIZE=$(wc -c < c.enc)
+TREE=$(le64 c.enc $((SIZE - 64 + 32)))
+
+# the nonce, the hashed flag, the original length, chunk 1's data, the
+# root tag, the first leaf and the root
+for at in 40 20 32 $((96 + CHUNK + 32 + 32 + 100)) $TREE $((TREE + 32)) $((SIZE - 65)); do
+	cp c.enc t.enc
+	flip t.enc $at
+
+	fails "$RAWAES" --verify -d k1 t.enc
+	fails "$RAWAES" -d k1 t.enc out
+done
+
+# a cleared hashed flag does not let a damaged chunk through either
+cp c.enc t.enc
+flip t.enc 20
+flip t.enc 200
+
+fails "$RAWAES" -d k1 t.enc out
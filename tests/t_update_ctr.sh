@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# --update of a CTR container encrypts the chunk it touches again under a
+# new keystream, and the container still checks out and decrypts to the
+# updated plaintext.  An ECB container is patched block by block.
+
+set -e
+
+CHUNK=1048576
+DATA=$((96 + CHUNK + 32 + 32))		# chunk 1's stored bytes
+AT=2000000
+
+. "$TESTS/lib.sh"
+
+head -c $((3 * CHUNK + 5000)) /dev/urandom > in
+printf 'WXYZ' > patch
+
+for mode in ctr ecb; do
+	cp in want
+	"$RAWAES" --container --mode=$mode -e k1 want c.enc
+	cp c.enc old.enc
+
+	"$RAWAES" --update --offset=$AT -e k1 patch c.enc
+	dd if=patch of=want bs=1 seek=$AT conv=notrunc 2>/dev/null
+
+	"$RAWAES" --verify -d k1 c.enc want
+	"$RAWAES" -d k1 c.enc back
+	cmp want back
+
+	if [ $mode = ctr ]; then
+		plain=$(xored in want $AT 4)
+		cipher=$(xored old.enc c.enc $((DATA + AT - CHUNK)) 4)
+		[ "$plain" != "$cipher" ]
+		[ "$(cmp -l -i $DATA -n $CHUNK old.enc c.enc | wc -l)" -gt 1000 ]
+	fi
+done